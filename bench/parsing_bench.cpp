@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+
+#include "BracketsDirectPredict.h"
+#include "Grammar.h"
+#include "LR1Parser.h"
+#include "LockstepParser.h"
+#include "MathDirectPredict.h"
+#include "NativeParser.h"
+#include "StateProfile.h"
+#include "StatementsDirectPredict.h"
+
+struct Workload {
+  std::string name;
+  Grammar grammar;
+  std::vector<std::string> words;
+  bool (*direct_predict)(std::string_view);
+};
+
+static const std::string kOpenBrackets = "abcdfghi";
+static const std::string kCloseBrackets = "ABCDFGHI";
+
+static Grammar ReadGrammarFile(const std::string& name) {
+  std::ifstream in(std::string(GRAMMARS_DIR) + "/" + name);
+  return ReadGrammar(in);
+}
+
+static std::string MakeMathWord(std::mt19937& random, int depth) {
+  std::string word;
+  int terms = 1 + random() % 3;
+  for (int i = 0; i < terms; ++i) {
+    if (i > 0) {
+      word += random() % 2 ? '+' : '*';
+    }
+    if (depth > 0 && random() % 3 == 0) {
+      word += '(' + MakeMathWord(random, depth - 1) + ')';
+    } else {
+      word += "xyz"[random() % 3];
+    }
+  }
+  return word;
+}
+
+static std::string MakeBracketsWord(std::mt19937& random, int depth) {
+  std::string word;
+  int items = 1 + random() % 3;
+  for (int i = 0; i < items; ++i) {
+    if (depth > 0 && random() % 2 == 0) {
+      int kind = random() % kOpenBrackets.size();
+      word += kOpenBrackets[kind];
+      word += MakeBracketsWord(random, depth - 1);
+      word += kCloseBrackets[kind];
+    } else {
+      word += 'x';
+    }
+  }
+  return word;
+}
+
+// Expands symbol by random rules, and past the depth by the rule with the
+// fewest nonterminals.
+static std::string MakeDerivedWord(const Grammar& grammar,
+                                   std::mt19937& random, char symbol,
+                                   int depth) {
+  Set<char> nonterminals = grammar.GetNonTerminals();
+  if (!nonterminals.contains(symbol)) {
+    return std::string(1, symbol);
+  }
+  std::vector<std::string> bodies;
+  for (const auto& [lhs, body] : grammar.GetProductionRules()) {
+    if (lhs == symbol) {
+      bodies.push_back(body);
+    }
+  }
+  const std::string* body = &bodies[random() % bodies.size()];
+  if (depth == 0) {
+    body = &*std::ranges::min_element(bodies, {}, [&](const auto& rule_body) {
+      return std::ranges::count_if(rule_body, [&](char body_symbol) {
+        return nonterminals.contains(body_symbol);
+      });
+    });
+  }
+  std::string word;
+  for (char body_symbol : *body) {
+    word += MakeDerivedWord(grammar, random, body_symbol,
+                            std::max(depth - 1, 0));
+  }
+  return word;
+}
+
+// Every fourth word gets a random byte replaced to exercise rejection.
+static void Corrupt(std::mt19937& random, std::vector<std::string>& words) {
+  for (int i = 0; i < words.size(); i += 4) {
+    if (!words[i].empty()) {
+      words[i][random() % words[i].size()] = static_cast<char>(random());
+    }
+  }
+}
+
+// Measured results are added up here so that their calls can't be dropped.
+static volatile uint64_t result_sink = 0;
+
+static void Consume(uint64_t value) {
+  result_sink = result_sink + value;
+}
+
+static void Consume(const std::vector<uint64_t>& accepted) {
+  Consume(accepted.empty() ? 0 : accepted.front());
+}
+
+static double MeasureNanoseconds(const std::vector<std::string>& words,
+                                 const std::function<bool(const std::string&)>&
+                                     predict) {
+  const int repeats = 20;
+  size_t accepted = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; ++r) {
+    for (const auto& word : words) {
+      accepted += predict(word);
+    }
+  }
+  auto finish = std::chrono::steady_clock::now();
+  Consume(accepted);
+  return std::chrono::duration<double, std::nano>(finish - start).count() /
+         (repeats * words.size());
+}
+
+int main() {
+  std::mt19937 random(2020);
+  std::vector<Workload> workloads;
+  workloads.push_back({"math", ReadGrammarFile("test/grammars/math.grammar"),
+                       {}, MathDirectPredict});
+  for (int i = 0; i < 20000; ++i) {
+    workloads.back().words.push_back(MakeMathWord(random, 4));
+  }
+  workloads.push_back({"brackets",
+                       ReadGrammarFile("bench/grammars/brackets.grammar"),
+                       {}, BracketsDirectPredict});
+  for (int i = 0; i < 20000; ++i) {
+    workloads.back().words.push_back(MakeBracketsWord(random, 4));
+  }
+  workloads.push_back({"statements",
+                       ReadGrammarFile("bench/grammars/statements.grammar"),
+                       {}, StatementsDirectPredict});
+  for (int i = 0; i < 20000; ++i) {
+    const Grammar& grammar = workloads.back().grammar;
+    workloads.back().words.push_back(
+        MakeDerivedWord(grammar, random, grammar.GetStartSymbol(), 4));
+  }
+
+  for (auto& workload : workloads) {
+    Corrupt(random, workload.words);
+    LR1Parser dense;
+    LR1Parser perfect_hash;
+    LR1Parser threaded;
+    LR1Parser jit;
+    LR1Parser prefiltered;
+    LR1Parser cached;
+    auto fit_start = std::chrono::steady_clock::now();
+    dense.Fit(workload.grammar);
+    auto fit_finish = std::chrono::steady_clock::now();
+    perfect_hash.Fit(workload.grammar,
+                     {.backend = TableBackend::PERFECT_HASH});
+    threaded.Fit(workload.grammar, {.backend = TableBackend::THREADED});
+    jit.Fit(workload.grammar, {.backend = TableBackend::JIT});
+    const int prefilter_depth = 4;
+    prefiltered.Fit(workload.grammar, {.prefilter_depth = prefilter_depth});
+    cached.Fit(workload.grammar, {.result_cache_capacity = 1 << 14});
+    const ParseTable& table = dense.GetTable();
+    auto hash_parser = std::dynamic_pointer_cast<const PerfectHashParser>(
+        perfect_hash.GetCompiledParser());
+    const int hot_count = 6;
+    std::vector<std::string> samples(workload.words.begin(),
+                                     workload.words.begin() + 1000);
+    NativeParser hybrid(table, {.hot_states = GetHotStates(
+        ProfileStates(table, samples), hot_count)});
+
+    std::cout << workload.name << ": " << table.states_count << " states, "
+              << table.classes_count << " classes, fit "
+              << std::chrono::duration<double, std::milli>(
+                     fit_finish - fit_start).count() << " ms\n";
+    std::cout << "  dense         "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return dense.Predict(word);
+                 }) << " ns/word, "
+              << table.actions.size() + table.gotos.size() << " cells\n";
+    std::cout << "  perfect hash  "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return perfect_hash.Predict(word);
+                 }) << " ns/word, "
+              << hash_parser->GetEntriesCount() << " entries\n";
+    std::cout << "  threaded      "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return threaded.Predict(word);
+                 }) << " ns/word\n";
+    std::cout << "  jit           "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return jit.Predict(word);
+                 }) << " ns/word\n";
+    std::cout << "  direct code   "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return workload.direct_predict(word);
+                 }) << " ns/word\n";
+    std::cout << "  hot states    "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return hybrid.Predict(word);
+                 }) << " ns/word, " << hot_count << " direct-coded\n";
+    std::string buffer;
+    std::vector<size_t> offsets = {0};
+    for (const auto& word : workload.words) {
+      buffer += word;
+      offsets.push_back(buffer.size());
+    }
+    const int batch_repeats = 20;
+    auto batch_start = std::chrono::steady_clock::now();
+    for (int r = 0; r < batch_repeats; ++r) {
+      Consume(dense.PredictBatch(buffer, offsets));
+    }
+    auto batch_finish = std::chrono::steady_clock::now();
+    int workers_count = WorkStealingPool::GetShared().GetWorkersCount();
+    std::cout << "  dense batch   "
+              << std::chrono::duration<double, std::nano>(
+                     batch_finish - batch_start).count() /
+                 (batch_repeats * workload.words.size())
+              << " ns/word, " << workers_count << " workers\n";
+    RegularFilter regular_filter(table, prefilter_depth);
+    std::cout << "  prefiltered   "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return prefiltered.Predict(word);
+                 }) << " ns/word, " << regular_filter.GetStatesCount()
+              << " DFA states at depth " << regular_filter.GetDepth() << "\n";
+    // Every word repeats once per measurement pass.
+    std::cout << "  cached        "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return cached.Predict(word);
+                 }) << " ns/word, "
+              << 100.0 * cached.GetResultCache()->GetHitsCount() /
+                 (cached.GetResultCache()->GetHitsCount() +
+                  cached.GetResultCache()->GetMissesCount())
+              << "% hits\n";
+    LockstepParser lockstep(dense.GetTable());
+    std::vector<uint64_t> accepted((workload.words.size() + 63) / 64);
+    auto lockstep_start = std::chrono::steady_clock::now();
+    for (int r = 0; r < batch_repeats; ++r) {
+      lockstep.Predict(buffer, offsets, accepted.data());
+    }
+    auto lockstep_finish = std::chrono::steady_clock::now();
+    Consume(accepted);
+    std::cout << "  lockstep      "
+              << std::chrono::duration<double, std::nano>(
+                     lockstep_finish - lockstep_start).count() /
+                 (batch_repeats * workload.words.size())
+              << " ns/word, "
+              << (LockstepParser::IsVectorized() ? "AVX-512" : "scalar")
+              << "\n";
+    // Groups of 16 words behind a stem of four others.
+    std::string stemmed_buffer;
+    std::vector<size_t> stemmed_offsets = {0};
+    for (size_t i = 0; i < workload.words.size(); ++i) {
+      size_t stem = i / 16 % (workload.words.size() - 3);
+      for (size_t j = stem; j < stem + 4; ++j) {
+        stemmed_buffer += workload.words[j];
+      }
+      stemmed_buffer += workload.words[i];
+      stemmed_offsets.push_back(stemmed_buffer.size());
+    }
+    auto stemmed_start = std::chrono::steady_clock::now();
+    for (int r = 0; r < batch_repeats; ++r) {
+      Consume(dense.PredictBatch(stemmed_buffer, stemmed_offsets));
+    }
+    auto stemmed_middle = std::chrono::steady_clock::now();
+    for (int r = 0; r < batch_repeats; ++r) {
+      Consume(dense.PredictBatchSharingPrefixes(stemmed_buffer,
+                                                stemmed_offsets));
+    }
+    auto stemmed_finish = std::chrono::steady_clock::now();
+    std::cout << "  shared stems  "
+              << std::chrono::duration<double, std::nano>(
+                     stemmed_finish - stemmed_middle).count() /
+                 (batch_repeats * workload.words.size())
+              << " ns/word, "
+              << std::chrono::duration<double, std::nano>(
+                     stemmed_middle - stemmed_start).count() /
+                 (batch_repeats * workload.words.size())
+              << " as a plain batch\n";
+    std::cout << "  next terminals "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   return dense.GetNextTerminals(word).expected.test(0);
+                 }) << " ns/word\n";
+    std::cout << "  action map    "
+              << MeasureNanoseconds(workload.words, [&](const auto& word) {
+                   ParseTrace trace;
+                   return dense.Predict(word, trace);
+                 }) << " ns/word\n";
+  }
+  return 0;
+}
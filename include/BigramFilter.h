@@ -0,0 +1,43 @@
+#ifndef LR1PARSER_BIGRAMFILTER_H
+#define LR1PARSER_BIGRAMFILTER_H
+
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "Grammar.h"
+
+// Necessary conditions for a word to be in the language of a grammar: every
+// byte is a terminal, the first and last ones can start and end a sentence,
+// and every pair of neighbours is adjacent somewhere in a sentence. Words
+// that fail them are rejected without parsing, the alphabet is scanned 32
+// bytes at a time where AVX2 is available.
+class BigramFilter {
+ public:
+  explicit BigramFilter(const Grammar& grammar);
+  [[nodiscard]] bool Admits(std::string_view word) const;
+  // Tokens above 255 are outside of the alphabet.
+  [[nodiscard]] bool Admits(std::span<const uint16_t> tokens) const;
+ private:
+  template <typename Symbol>
+  bool AdmitsPairs_(const Symbol* begin, const Symbol* end) const;
+  bool AdmitsAlphabet_(std::string_view word) const;
+  bool AdmitsAlphabetVectorized_(std::string_view word) const;
+
+  std::bitset<256> alphabet_;
+  std::bitset<256> first_;
+  std::bitset<256> last_;
+  bool admits_empty_ = false;
+  // Row a holds the terminals that may follow a, as bits of 4 words.
+  std::array<std::array<uint64_t, 4>, 256> followers_ = {};
+  // Nibble tables for the vectorized alphabet scan: bit h of low_rows_[l] is
+  // set if the byte 16 * h + l is a terminal, high_rows_ is for h >= 8.
+  std::array<uint8_t, 16> low_rows_ = {};
+  std::array<uint8_t, 16> high_rows_ = {};
+};
+
+
+#endif
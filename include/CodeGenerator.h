@@ -0,0 +1,30 @@
+#ifndef LR1PARSER_CODEGENERATOR_H
+#define LR1PARSER_CODEGENERATOR_H
+
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "ParseTable.h"
+
+// Writes a header defining struct `name` with the table as constexpr arrays,
+// to be parsed with StaticPredict<name> from StaticParser.h.
+void WriteTablesHeader(std::ostream& out, const ParseTable& table,
+                       const std::string& name);
+
+// Writes a header defining `bool name(std::string_view word)` with every
+// state as its own block of code: a switch on the lookahead class, shifts
+// as jumps to the next block and reductions as pops plus a switch over the
+// uncovered state.
+void WriteDirectParser(std::ostream& out, const ParseTable& table,
+                       const std::string& name);
+
+// Like WriteDirectParser, but only the hot states get their own code, the
+// rest are dispatched through the tables.
+void WriteHybridParser(std::ostream& out, const ParseTable& table,
+                       const std::string& name,
+                       const std::vector<int>& hot_states);
+
+
+#endif
@@ -2,6 +2,7 @@
 #define LR1PARSER_GRAMMAR_H
 
 
+#include <iosfwd>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -47,5 +48,11 @@ class Grammar {
   char start_ = '\0';
 };
 
+// Reads rules like "S -> aSbS |", one nonterminal per line with alternatives
+// separated by '|'. Left-hand sides are the nonterminals, the first one is
+// the start symbol, every other symbol is a terminal. Whitespace is ignored
+// and '#' starts a comment.
+Grammar ReadGrammar(std::istream& in);
+
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef LR1PARSER_JITPARSER_H
+#define LR1PARSER_JITPARSER_H
+
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "ParseTable.h"
+#include "TableParser.h"
+
+// Parser compiled in process to x86-64 machine code: a block per state with
+// a compare/jump chain over the lookahead classes, shifts as jumps between
+// blocks and a jump table of goto targets per nonterminal. The code lives in
+// its own mapping, which is made executable once it's written.
+class JitParser : public CompiledParser {
+ public:
+  explicit JitParser(const ParseTable& table);
+  ~JitParser() override;
+  JitParser(const JitParser&) = delete;
+  JitParser& operator=(const JitParser&) = delete;
+  using CompiledParser::Predict;
+  [[nodiscard]] bool Predict(std::string_view word) const override;
+  [[nodiscard]] size_t GetStateBytes() const override;
+  // The states are code, there are no cells.
+  [[nodiscard]] size_t GetCellBytes() const override;
+  [[nodiscard]] size_t GetCodeBytes() const;
+  [[nodiscard]] static bool IsSupported();
+ private:
+  void* memory_ = nullptr;
+  size_t memory_bytes_ = 0;
+  size_t code_bytes_ = 0;
+  int (*parse_)(const char* word, uint32_t* stack, uint32_t* stack_end,
+                const char* word_end) = nullptr;
+};
+
+// JitParser where it's supported, the dense table interpreter elsewhere.
+std::unique_ptr<CompiledParser> MakeJitParser(const ParseTable& table);
+
+
+#endif
@@ -2,10 +2,32 @@
 #define LR1PARSER_H
 
 
+#include <atomic>
+#include <bitset>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 
+#include "BigramFilter.h"
 #include "Grammar.h"
+#include "JitParser.h"
+#include "LockstepParser.h"
+#include "NativeParser.h"
+#include "ParseTable.h"
+#include "PerfectHashParser.h"
+#include "PrefixSharingParser.h"
+#include "PushParser.h"
+#include "RegularFilter.h"
+#include "ResultCache.h"
+#include "TableParser.h"
+#include "ThreadedParser.h"
+#include "WorkStealingPool.h"
 #include "gtest/gtest.h"
 
 struct Situation {
@@ -48,24 +70,172 @@ enum {
 };
 using Action = std::variant<int, ProductionRule, Accept>;
 
+class TableCache;
+
+enum class TableBackend {
+  DENSE,
+  PERFECT_HASH,
+  // Dense tables with a computed-goto dispatch loop.
+  THREADED,
+  // Machine code generated at Fit, the dense tables where there's no JIT.
+  JIT
+};
+
+struct FitOptions {
+  // Rewrite gotos so that unit reductions (A -> B) in consistent states
+  // are skipped at parse time.
+  bool eliminate_unit_rules = false;
+  TableBackend backend = TableBackend::DENSE;
+  // Rejects words with bytes or pairs of neighbours that no sentence has
+  // before parsing them. Loaded and mapped parsers don't filter.
+  bool filter_input = true;
+  // Runs the minimal DFA of a regular superset of the language before
+  // parsing, with parse stacks cut at this depth in it. 0 turns it off.
+  int prefilter_depth = 0;
+  // Keeps the results of up to this many words for Predict(std::string_view)
+  // to return without parsing, 0 turns it off.
+  size_t result_cache_capacity = 0;
+  // Reuses the tables of a grammar fitted before with the same options. A
+  // parser fitted from the cache can't produce traces.
+  TableCache* cache = nullptr;
+};
+
+struct ParseTrace {
+  // Applied production rules in order, including bypassed unit rules.
+  std::vector<ProductionRule> derivation;
+  // Reductions actually performed by the parser.
+  int reductions = 0;
+};
+
+struct NextTerminals {
+  // Bit b is set if the byte b may come next, bit 0 if the input may end.
+  std::bitset<256> expected;
+  // First byte that no sentence has after the bytes before it, or npos. The
+  // expected set is then the one at that position.
+  size_t error_position = std::string_view::npos;
+};
+
 class LR1Parser {
  public:
-  void Fit(const Grammar& grammar);
-  [[nodiscard]] bool Predict(const std::string& word) const;
+  LR1Parser() = default;
+  LR1Parser(const LR1Parser&) = delete;
+  LR1Parser& operator=(const LR1Parser&) = delete;
+  ~LR1Parser();
+  void Fit(const Grammar& grammar, const FitOptions& options = {});
+  // The word ends after its last byte, a NUL inside it is an ordinary byte
+  // outside of the alphabet.
+  [[nodiscard]] bool Predict(std::string_view word) const;
+  // Pre-tokenized input with a terminal per token, tokens above 255 are
+  // outside of the alphabet.
+  [[nodiscard]] bool Predict(std::span<const uint16_t> tokens) const;
+  // Other ranges of chars, such as std::span<const char>. Contiguous ones are
+  // parsed in place, the rest are gathered into a buffer first.
+  template <std::ranges::input_range Range>
+    requires std::same_as<std::ranges::range_value_t<Range>, char> &&
+             (!std::convertible_to<Range, std::string_view>)
+  [[nodiscard]] bool Predict(Range&& word) const {
+    if constexpr (std::ranges::contiguous_range<Range> &&
+                  std::ranges::sized_range<Range>) {
+      return Predict(std::string_view(std::ranges::data(word),
+                                      std::ranges::size(word)));
+    } else {
+      thread_local std::string buffer;
+      buffer.clear();
+      for (char symbol : word) {
+        buffer.push_back(symbol);
+      }
+      return Predict(std::string_view(buffer));
+    }
+  }
+  bool Predict(std::string_view word, ParseTrace& trace) const;
+  // Terminals that may follow the prefix, from sets made at Fit for every
+  // state. Takes a parse of the prefix and a read of its last state's set.
+  // Parsers that can't produce traces can't answer either.
+  [[nodiscard]] NextTerminals GetNextTerminals(std::string_view prefix) const;
+  // Word i is buffer[offsets[i], offsets[i + 1]). Bit i % 64 of element
+  // i / 64 of the result is set if it's accepted. The words are spread over
+  // the pool, the shared one by default. A fitted dense parser runs each
+  // block through the lockstep parser where AVX-512 is available.
+  [[nodiscard]] std::vector<uint64_t> PredictBatch(
+      std::string_view buffer, std::span<const size_t> offsets,
+      WorkStealingPool* pool = nullptr) const;
+  // Same result as PredictBatch, for batches whose words share long
+  // prefixes: the words are sorted and each shared prefix is parsed once, on
+  // the calling thread. Mapped parsers parse the words one by one.
+  [[nodiscard]] std::vector<uint64_t> PredictBatchSharingPrefixes(
+      std::string_view buffer, std::span<const size_t> offsets) const;
+  // Parser for input that arrives in chunks, over the dense tables whatever
+  // the backend. It shares the tables and may outlive this parser.
+  [[nodiscard]] std::unique_ptr<PushParser> MakePushParser() const;
+  [[nodiscard]] const ParseTable& GetTable() const;
+  [[nodiscard]] std::shared_ptr<const CompiledParser> GetCompiledParser() const;
+  // Null unless FitOptions::result_cache_capacity is set.
+  [[nodiscard]] const ResultCache* GetResultCache() const;
+  // Versioned binary dump of the compiled tables. A loaded parser predicts
+  // without refitting, but can't produce traces.
+  void Save(std::ostream& out) const;
+  void Load(std::istream& in);
+  // Relocatable image of the dense tables that MapImage parses from in place.
+  // A mapped parser has neither traces nor a ParseTable to Save. Mapping
+  // without verify_payload is O(1) but only safe for trusted files.
+  void SaveImage(const std::string& path) const;
+  void MapImage(const std::string& path, bool verify_payload = true,
+                TableBackend backend = TableBackend::DENSE);
+  // Compiles the fitted tables to native code in the background and swaps it
+  // in once it's loaded, Predict keeps using the tables until then. The
+  // future rethrows compile errors, after which the tables stay in use.
+  std::shared_future<void> CompileNative(const NativeOptions& options = {});
  private:
   Set<char> First_(const std::string& expression) const;
   Set<Situation> Closure_(const Set<Situation>& situations) const;
   Set<Situation> Goto_(const Set<Situation>& situations,
                        const char symbol) const;
   void MakeStates_(const Grammar& grammar);
+  void MakeActions_(const Grammar& grammar);
+  void MakeDefaultReductions_(const Situation& end_situation);
+  void MakeExpectedTerminals_();
+  void EliminateUnitRules_();
+  void MakeTable_();
+  void MakeCompiledParser_();
+  const LockstepParser* GetLockstepParser_() const;
+  bool Predict_(std::string_view word, ParseTrace* trace) const;
+  bool PredictUncached_(std::string_view word) const;
+  const Action* FindAction_(int state, char symbol) const;
   Situation Init_(const Grammar& grammar);
   void Clear_();
 
   std::unordered_map<std::pair<int, char>, Action> actions_;
   std::vector<State> states_;
+  // Reduction used for any lookahead without an explicit entry in actions_.
+  std::vector<std::optional<Action>> default_reductions_;
+  // Terminals in the items of each state, '\0' for the end of input.
+  std::vector<std::bitset<256>> expected_terminals_;
+  // States with a single reduction and no shifts: reduce without lookahead.
+  std::vector<bool> consistent_states_;
+  // Unit rules skipped by a rewritten goto, for derivation traces.
+  std::unordered_map<std::pair<int, char>,
+                     std::vector<ProductionRule>> unit_chains_;
   Set<char> nonterminals_;
   Set<char> terminals_;
   std::vector<ProductionRule> production_rules_;
+  FitOptions options_;
+  ParseTable table_;
+  std::shared_ptr<const TableImage> image_;
+  std::shared_ptr<const CompiledParser> compiled_parser_;
+  std::shared_ptr<const CompiledParser> native_parser_;
+  // Replaced native parsers, kept until Fit since Predict may still run them.
+  std::vector<std::shared_ptr<const CompiledParser>> retired_parsers_;
+  mutable std::mutex native_mutex_;
+  // Built by the first batch that can use it.
+  mutable std::unique_ptr<const LockstepParser> lockstep_parser_;
+  mutable std::mutex lockstep_mutex_;
+  std::unique_ptr<const PrefixSharingParser> prefix_parser_;
+  std::optional<BigramFilter> input_filter_;
+  std::optional<RegularFilter> regular_filter_;
+  std::unique_ptr<ResultCache> result_cache_;
+  std::shared_future<void> native_compilation_;
+  // Either compiled_parser_ or, once it's published, native_parser_.
+  std::atomic<const CompiledParser*> active_parser_ = nullptr;
   const char new_start_ = '$';  // doesn't matter ?
   bool IsNonTerminal_(const char symbol) const;
 
@@ -0,0 +1,43 @@
+#ifndef LR1PARSER_LOCKSTEPPARSER_H
+#define LR1PARSER_LOCKSTEPPARSER_H
+
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "ParseTable.h"
+
+// Parses a batch of words in lockstep, one word per lane of an AVX-512
+// register: table lookups are gathers, every lane has its own stack, and a
+// lane whose word is done takes the next one. Words too deep for the lane
+// stacks, and whole batches on CPUs without AVX-512, are parsed one by one.
+class LockstepParser {
+ public:
+  explicit LockstepParser(const ParseTable& table);
+  // Word i is buffer[offsets[i], offsets[i + 1]), bit i % 64 of
+  // accepted[i / 64] is set if it's accepted and cleared otherwise.
+  void Predict(std::string_view buffer, std::span<const size_t> offsets,
+               uint64_t* accepted) const;
+  [[nodiscard]] static bool IsVectorized();
+ private:
+  bool PredictWord_(std::string_view word) const;
+  void PredictVectorized_(std::string_view buffer,
+                          std::span<const size_t> offsets,
+                          uint64_t* accepted) const;
+
+  // The tables widened to 32 bits for gathers.
+  std::vector<int32_t> input_classes_;
+  int32_t end_class_;
+  int32_t classes_count_;
+  int32_t nonterminals_count_;
+  std::vector<int32_t> actions_;
+  std::vector<int32_t> gotos_;
+  std::vector<int32_t> consistent_actions_;
+  std::vector<int32_t> rule_lhs_;
+  std::vector<int32_t> rule_lengths_;
+};
+
+
+#endif
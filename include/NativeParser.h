@@ -0,0 +1,45 @@
+#ifndef LR1PARSER_NATIVEPARSER_H
+#define LR1PARSER_NATIVEPARSER_H
+
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ParseTable.h"
+#include "TableParser.h"
+
+struct NativeOptions {
+  // Compiler driver run through the shell, with the source file, -shared,
+  // -fPIC, -fvisibility=hidden and the output path appended.
+  std::string compiler = "c++";
+  std::string flags = "-std=c++17 -O2";
+  // Compiles WriteHybridParser code with only these states direct-coded,
+  // see GetHotStates. Every state is direct-coded if empty.
+  std::vector<int> hot_states;
+};
+
+// Direct-coded parser from WriteDirectParser, compiled by the system compiler
+// into a shared library and loaded with dlopen. The library stays loaded for
+// the lifetime of the parser; its files are removed once it's loaded.
+class NativeParser : public CompiledParser {
+ public:
+  explicit NativeParser(const ParseTable& table,
+                        const NativeOptions& options = {});
+  ~NativeParser() override;
+  NativeParser(const NativeParser&) = delete;
+  NativeParser& operator=(const NativeParser&) = delete;
+  using CompiledParser::Predict;
+  [[nodiscard]] bool Predict(std::string_view word) const override;
+  [[nodiscard]] size_t GetStateBytes() const override;
+  // The states are code, there are no cells.
+  [[nodiscard]] size_t GetCellBytes() const override;
+ private:
+  void* library_ = nullptr;
+  bool (*predict_)(const char* data, size_t size) = nullptr;
+  size_t state_bytes_;
+};
+
+
+#endif
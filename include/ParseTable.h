@@ -0,0 +1,67 @@
+#ifndef LR1PARSER_PARSETABLE_H
+#define LR1PARSER_PARSETABLE_H
+
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+enum {
+  CELL_ERROR,
+  CELL_SHIFT,
+  CELL_REDUCE,
+  CELL_ACCEPT
+};
+
+// Action cell: the kind in the two low bits, the target state (shift) or the
+// rule index (reduce) in the rest.
+using Cell = uint32_t;
+
+constexpr Cell MakeCell(int kind, int payload) {
+  return (static_cast<Cell>(payload) << 2) | kind;
+}
+
+constexpr int GetCellKind(Cell cell) {
+  return static_cast<int>(cell & 3);
+}
+
+constexpr int GetCellPayload(Cell cell) {
+  return static_cast<int>(cell >> 2);
+}
+
+struct RuleInfo {
+  int lhs;
+  int length;
+  bool operator==(const RuleInfo&) const = default;
+};
+
+// Dense tables built by LR1Parser::Fit. Terminals whose action columns match
+// in every state share a class, so a row holds one cell per class.
+struct ParseTable {
+  // Input byte -> terminal class. Class 0 is every byte that isn't a terminal.
+  std::array<uint8_t, 256> symbol_classes = {};
+  int classes_count = 0;
+  int nonterminals_count = 0;
+  int states_count = 0;
+  // states_count x classes_count, missing entries hold the default reduction.
+  std::vector<Cell> actions;
+  // states_count x nonterminals_count, -1 where there is no goto.
+  std::vector<int> gotos;
+  // Default reduction of consistent states, CELL_ERROR for the others.
+  std::vector<Cell> consistent_actions;
+  // Distinct (lhs, length) pairs of the production rules.
+  std::vector<RuleInfo> rules;
+};
+
+// Compact little-endian encoding, cells and states take the narrowest width
+// that fits. Reading checks that every index stays within the table.
+void WriteParseTable(std::ostream& out, const ParseTable& table);
+ParseTable ReadParseTable(std::istream& in);
+// Whether no reduction pops more states than the shortest stack its state can
+// be reached with, over shifts and gotos from state 0. The indices have to be
+// within the table already.
+bool ReductionsFitStacks(const ParseTable& table);
+
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef LR1PARSER_PERFECTHASHPARSER_H
+#define LR1PARSER_PERFECTHASHPARSER_H
+
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "ParseTable.h"
+#include "TableParser.h"
+
+// Stores only the explicit entries of a ParseTable: terminal classes and
+// gotos keyed by (state, symbol) in a minimal perfect hash, with a default
+// cell per state for the rest. Meant for huge alphabets with sparse rows.
+class PerfectHashParser : public CompiledParser {
+ public:
+  explicit PerfectHashParser(const ParseTable& table);
+  [[nodiscard]] bool Predict(std::string_view word) const override;
+  [[nodiscard]] bool Predict(std::span<const uint16_t> tokens) const override;
+  [[nodiscard]] size_t GetStateBytes() const override;
+  [[nodiscard]] size_t GetCellBytes() const override;
+  [[nodiscard]] size_t GetEntriesCount() const;
+ private:
+  struct Slot {
+    uint32_t key;
+    Cell cell;
+  };
+  static uint32_t Hash_(uint32_t key, uint32_t seed);
+  [[nodiscard]] Cell Find_(int state, int symbol) const;
+  template <typename Symbol>
+  bool Parse_(const Symbol* symbol, const Symbol* end) const;
+
+  std::array<uint8_t, 256> input_classes_;
+  uint8_t end_class_;
+  int symbols_count_;
+  int classes_count_;
+  std::vector<uint32_t> seeds_;
+  std::vector<Slot> slots_;
+  std::vector<Cell> default_actions_;
+  std::vector<Cell> consistent_actions_;
+  std::vector<RuleInfo> rules_;
+};
+
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef LR1PARSER_PERSISTENTSTACK_H
+#define LR1PARSER_PERSISTENTSTACK_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Storage for persistent stacks. Segments are never freed one by one: Reset
+// drops all of them at once, and every stack pushed in the arena with them.
+// Not thread-safe.
+class StackArena {
+ public:
+  StackArena() = default;
+  StackArena(const StackArena&) = delete;
+  StackArena& operator=(const StackArena&) = delete;
+  // Keeps the memory for the next segments.
+  void Reset();
+  [[nodiscard]] size_t GetSegmentsCount() const;
+
+  static const int kSegmentSize = 14;
+ private:
+  friend class PersistentStack;
+  struct Segment {
+    Segment* below;
+    // Size of the stack under the segment.
+    uint32_t base;
+    // Slots filled by any of the stacks sharing the segment.
+    uint32_t used;
+    int32_t states[kSegmentSize];
+  };
+
+  Segment* Allocate_(Segment* below, uint32_t base);
+
+  std::vector<std::unique_ptr<Segment[]>> blocks_;
+  size_t block_index_ = 0;
+  size_t block_used_ = 0;
+  size_t segments_count_ = 0;
+};
+
+// Immutable stack of parser states in linked segments of an arena. Push and
+// Pop return new stacks that share the segments, so a copy is an O(1)
+// snapshot or fork. A push onto the end of a segment fills its next slot in
+// place; stacks that see fewer slots aren't affected. Pushing anywhere else
+// starts a new segment.
+class PersistentStack {
+ public:
+  PersistentStack() = default;
+  [[nodiscard]] PersistentStack Push(StackArena& arena, int32_t state) const;
+  [[nodiscard]] PersistentStack Pop(size_t count = 1) const;
+  [[nodiscard]] int32_t Top() const;
+  [[nodiscard]] size_t GetSize() const;
+  [[nodiscard]] bool IsEmpty() const;
+ private:
+  PersistentStack(StackArena::Segment* segment, uint32_t size):
+      segment_(segment), size_(size) {}
+
+  StackArena::Segment* segment_ = nullptr;
+  uint32_t size_ = 0;
+};
+
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef LR1PARSER_PREFIXSHARINGPARSER_H
+#define LR1PARSER_PREFIXSHARINGPARSER_H
+
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "ParseTable.h"
+
+// Parses a batch of words in sorted order, so that a prefix shared with the
+// previous word is parsed once: the persistent stack after each shifted
+// symbol of the current word is kept, and the next word resumes from the one
+// after their common prefix. The work is linear in the size of the trie of
+// the words, plus the sort.
+class PrefixSharingParser {
+ public:
+  // The table is parsed from in place, so it has to outlive the parser.
+  explicit PrefixSharingParser(const ParseTable& table);
+  // Word i is buffer[offsets[i], offsets[i + 1]), bit i % 64 of
+  // accepted[i / 64] is set if it's accepted and cleared otherwise.
+  void Predict(std::string_view buffer, std::span<const size_t> offsets,
+               uint64_t* accepted) const;
+ private:
+  const ParseTable& table_;
+};
+
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef LR1PARSER_PUSHPARSER_H
+#define LR1PARSER_PUSHPARSER_H
+
+
+#include <memory>
+#include <string_view>
+
+#include "TableImage.h"
+#include "TableParser.h"
+
+// Parse of input that arrives in chunks. The stack is kept between calls, so
+// Feed may be called any number of times between Begin and Finish.
+class PushParser {
+ public:
+  virtual ~PushParser() = default;
+  virtual void Begin() = 0;
+  // Returns false as soon as no continuation of the input fed so far can be
+  // accepted, later calls ignore their chunks.
+  virtual bool Feed(std::string_view chunk) = 0;
+  // Ends the input, returns whether it was accepted.
+  virtual bool Finish() = 0;
+};
+
+// Push parser over the dense tables of a TableImage.
+template <typename StateT, typename CellT>
+class TablePushParser : public PushParser,
+                        private TableParser<StateT, CellT> {
+ public:
+  explicit TablePushParser(std::shared_ptr<const TableImage> image);
+  void Begin() override;
+  bool Feed(std::string_view chunk) override;
+  bool Finish() override;
+ private:
+  // Performs the actions for the lookahead class up to its shift, returns
+  // false on an error.
+  bool Step_(uint8_t symbol_class);
+
+  ParseStack<StateT> stack_;
+  bool rejected_ = false;
+  bool accepted_ = false;
+};
+
+std::unique_ptr<PushParser> MakePushParser(
+    std::shared_ptr<const TableImage> image);
+
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef LR1PARSER_REGULARFILTER_H
+#define LR1PARSER_REGULARFILTER_H
+
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "ParseTable.h"
+
+// Minimal DFA for a regular superset of the language of the tables. It runs
+// the parser with stacks cut to their top states, a reduction that pops past
+// the cut may uncover any state with a goto on its nonterminal. Words it
+// rejects can't be parsed, and it costs a table lookup per byte.
+class RegularFilter {
+ public:
+  // Stacks are cut at depth states, or shallower if the DFA would get too
+  // large.
+  RegularFilter(const ParseTable& table, int depth);
+  [[nodiscard]] bool Admits(std::string_view word) const;
+  // Tokens above 255 are outside of the alphabet.
+  [[nodiscard]] bool Admits(std::span<const uint16_t> tokens) const;
+  [[nodiscard]] int GetDepth() const;
+  [[nodiscard]] int GetStatesCount() const;
+ private:
+  bool Build_(const ParseTable& table, int depth);
+  void Minimize_();
+
+  std::array<uint8_t, 256> input_classes_;
+  int classes_count_ = 0;
+  int depth_ = 0;
+  int start_ = 0;
+  // -1 if every state can still reach an accepting one.
+  int dead_ = -1;
+  // states x classes.
+  std::vector<int32_t> transitions_;
+  std::vector<uint8_t> accepting_;
+};
+
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef LR1PARSER_RESULTCACHE_H
+#define LR1PARSER_RESULTCACHE_H
+
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Bounded map from words to Predict results. The words are hashed into
+// shards with a lock each, and a shard evicts with the CLOCK policy: a hit
+// marks the entry, and the hand spares marked entries once. Thread-safe.
+class ResultCache {
+ public:
+  explicit ResultCache(size_t capacity, int shards_count = 16);
+  // Counts a hit or a miss.
+  std::optional<bool> Find(std::string_view word);
+  // Words longer than kMaxWordSize aren't kept.
+  void Insert(std::string_view word, bool accepted);
+  [[nodiscard]] size_t GetHitsCount() const;
+  [[nodiscard]] size_t GetMissesCount() const;
+  [[nodiscard]] size_t GetSize() const;
+
+  static const size_t kMaxWordSize = 256;
+ private:
+  struct Entry {
+    std::string word;
+    uint64_t hash;
+    bool accepted;
+    bool referenced;
+  };
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    // Hash -> index in entries, a colliding word replaces the entry.
+    std::unordered_map<uint64_t, uint32_t> indices;
+    std::vector<Entry> entries;
+    size_t capacity = 0;
+    size_t hand = 0;
+    size_t hits_count = 0;
+    size_t misses_count = 0;
+  };
+
+  Shard& GetShard_(uint64_t hash) const;
+
+  std::unique_ptr<Shard[]> shards_;
+  int shards_count_;
+};
+
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef LR1PARSER_STATEPROFILE_H
+#define LR1PARSER_STATEPROFILE_H
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ParseTable.h"
+
+// Number of times each state is entered while parsing the samples.
+std::vector<uint64_t> ProfileStates(const ParseTable& table,
+                                    const std::vector<std::string>& samples);
+
+// At most count states that were entered, most frequent first.
+std::vector<int> GetHotStates(const std::vector<uint64_t>& profile,
+                              int count);
+
+
+#endif
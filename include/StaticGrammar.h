@@ -0,0 +1,374 @@
+#ifndef LR1PARSER_STATICGRAMMAR_H
+#define LR1PARSER_STATICGRAMMAR_H
+
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "ParseTable.h"
+#include "StaticParser.h"
+
+// Grammar text in the ReadGrammar format, usable as a template argument.
+template <size_t N>
+struct GrammarLiteral {
+  char text[N] = {};
+  constexpr GrammarLiteral(const char (&literal)[N]) {
+    std::copy_n(literal, N, text);
+  }
+  [[nodiscard]] constexpr std::string_view View() const {
+    return {text, N - 1};
+  }
+};
+
+// Canonical LR(1) construction that runs in constant expressions. Columns
+// are class 0 for bytes outside of the alphabet, class 1 for the end of
+// input and one class per terminal; states get default reductions as in
+// LR1Parser::Fit. Errors in the grammar are thrown, which fails compilation
+// when building in a constant expression.
+class StaticTablesBuilder {
+ public:
+  constexpr explicit StaticTablesBuilder(std::string_view text) {
+    ReadRules_(text);
+    MakeFirst_();
+    MakeStates_();
+    MakeTables_();
+  }
+
+  std::array<uint8_t, 256> symbol_classes = {};
+  int states_count = 0;
+  int classes_count = 0;
+  int nonterminals_count = 0;
+  std::vector<Cell> actions;
+  std::vector<int> gotos;
+  std::vector<Cell> consistent_actions;
+  std::vector<RuleInfo> rules;
+ private:
+  struct Rule {
+    int lhs;
+    std::vector<int> rhs;
+  };
+  struct Item {
+    int rule;
+    int dot;
+    int lookahead;
+    constexpr auto operator<=>(const Item&) const = default;
+  };
+
+  // Symbol 0 is the end of input, then terminals and nonterminals follow.
+  [[nodiscard]] constexpr bool IsNonTerminal_(int symbol) const {
+    return symbol > terminals_count_;
+  }
+
+  constexpr void ReadRules_(std::string_view text) {
+    std::vector<std::pair<char, std::string_view>> alternatives;
+    std::vector<char> lhs_symbols;
+    std::vector<char> rhs_symbols;
+    while (!text.empty()) {
+      size_t end = text.find('\n');
+      std::string_view line = text.substr(0, end);
+      text = end == std::string_view::npos ? "" : text.substr(end + 1);
+      line = line.substr(0, line.find('#'));
+      std::vector<char> symbols;
+      for (char symbol : line) {
+        if (symbol != ' ' && symbol != '\t' && symbol != '\r') {
+          symbols.push_back(symbol);
+        }
+      }
+      if (symbols.empty()) {
+        continue;
+      }
+      if (symbols.size() < 3 || symbols[1] != '-' || symbols[2] != '>') {
+        throw std::invalid_argument("Bad grammar line.");
+      }
+      lhs_symbols.push_back(symbols[0]);
+      std::vector<char> rhs;
+      for (size_t i = 3; i <= symbols.size(); ++i) {
+        if (i == symbols.size() || symbols[i] == '|') {
+          rules_.push_back({symbols[0], {rhs.begin(), rhs.end()}});
+          rhs.clear();
+        } else {
+          rhs.push_back(symbols[i]);
+          rhs_symbols.push_back(symbols[i]);
+        }
+      }
+    }
+    if (rules_.empty()) {
+      throw std::invalid_argument("Grammar has no rules.");
+    }
+    std::sort(lhs_symbols.begin(), lhs_symbols.end());
+    lhs_symbols.erase(std::unique(lhs_symbols.begin(), lhs_symbols.end()),
+                      lhs_symbols.end());
+    std::vector<char> terminals;
+    for (char symbol : rhs_symbols) {
+      if (!std::binary_search(lhs_symbols.begin(), lhs_symbols.end(),
+                              symbol)) {
+        terminals.push_back(symbol);
+      }
+    }
+    std::sort(terminals.begin(), terminals.end());
+    terminals.erase(std::unique(terminals.begin(), terminals.end()),
+                    terminals.end());
+    terminals_count_ = terminals.size();
+    nonterminals_count = lhs_symbols.size();
+
+    std::array<int, 256> symbol_ids = {};
+    for (int i = 0; i < terminals.size(); ++i) {
+      symbol_ids[static_cast<uint8_t>(terminals[i])] = 1 + i;
+    }
+    for (int i = 0; i < lhs_symbols.size(); ++i) {
+      symbol_ids[static_cast<uint8_t>(lhs_symbols[i])] =
+          1 + terminals_count_ + i;
+    }
+    for (Rule& rule : rules_) {
+      rule.lhs = symbol_ids[static_cast<uint8_t>(rule.lhs)];
+      for (int& symbol : rule.rhs) {
+        symbol = symbol_ids[static_cast<uint8_t>(symbol)];
+      }
+    }
+    // Rule 0 is the augmented start rule.
+    rules_.insert(rules_.begin(), Rule{-1, {rules_.front().lhs}});
+
+    classes_count = terminals_count_ + 2;
+    symbol_classes[0] = 1;
+    for (int i = 0; i < terminals.size(); ++i) {
+      symbol_classes[static_cast<uint8_t>(terminals[i])] = 2 + i;
+    }
+  }
+
+  constexpr void MakeFirst_() {
+    nullable_.assign(nonterminals_count, false);
+    first_.assign(nonterminals_count,
+                  std::vector<bool>(terminals_count_ + 1, false));
+    for (bool changed = true; changed; ) {
+      changed = false;
+      for (int r = 1; r < rules_.size(); ++r) {
+        int lhs = rules_[r].lhs - terminals_count_ - 1;
+        std::vector<bool> first(terminals_count_ + 1, false);
+        bool nullable = AddFirst_(rules_[r].rhs, 0, first);
+        for (int t = 0; t <= terminals_count_; ++t) {
+          if (first[t] && !first_[lhs][t]) {
+            first_[lhs][t] = true;
+            changed = true;
+          }
+        }
+        if (nullable && !nullable_[lhs]) {
+          nullable_[lhs] = true;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Adds FIRST(symbols[begin:]) and tells whether that suffix is nullable.
+  constexpr bool AddFirst_(const std::vector<int>& symbols, size_t begin,
+                           std::vector<bool>& first) const {
+    for (size_t i = begin; i < symbols.size(); ++i) {
+      if (!IsNonTerminal_(symbols[i])) {
+        first[symbols[i]] = true;
+        return false;
+      }
+      int nonterminal = symbols[i] - terminals_count_ - 1;
+      for (int t = 0; t <= terminals_count_; ++t) {
+        first[t] = first[t] || first_[nonterminal][t];
+      }
+      if (!nullable_[nonterminal]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr std::vector<Item> Closure_(std::vector<Item> items) const {
+    for (size_t i = 0; i < items.size(); ++i) {
+      Item item = items[i];
+      const auto& rhs = rules_[item.rule].rhs;
+      if (item.dot == rhs.size() || !IsNonTerminal_(rhs[item.dot])) {
+        continue;
+      }
+      std::vector<bool> lookaheads(terminals_count_ + 1, false);
+      if (AddFirst_(rhs, item.dot + 1, lookaheads)) {
+        lookaheads[item.lookahead] = true;
+      }
+      for (int r = 1; r < rules_.size(); ++r) {
+        if (rules_[r].lhs != rhs[item.dot]) {
+          continue;
+        }
+        for (int t = 0; t <= terminals_count_; ++t) {
+          Item new_item{r, 0, t};
+          if (lookaheads[t] && std::find(items.begin(), items.end(),
+                                         new_item) == items.end()) {
+            items.push_back(new_item);
+          }
+        }
+      }
+    }
+    std::sort(items.begin(), items.end());
+    return items;
+  }
+
+  constexpr void MakeStates_() {
+    int symbols_count = 1 + terminals_count_ + nonterminals_count;
+    states_.push_back(Closure_({{0, 0, 0}}));
+    for (int i = 0; i < states_.size(); ++i) {
+      transitions_.emplace_back(symbols_count, -1);
+      for (int symbol = 1; symbol < symbols_count; ++symbol) {
+        std::vector<Item> kernel;
+        for (Item item : states_[i]) {
+          const auto& rhs = rules_[item.rule].rhs;
+          if (item.dot < rhs.size() && rhs[item.dot] == symbol) {
+            kernel.push_back({item.rule, item.dot + 1, item.lookahead});
+          }
+        }
+        if (kernel.empty()) {
+          continue;
+        }
+        auto state = Closure_(kernel);
+        auto it = std::find(states_.begin(), states_.end(), state);
+        transitions_[i][symbol] = it - states_.begin();
+        if (it == states_.end()) {
+          states_.push_back(state);
+        }
+      }
+    }
+  }
+
+  constexpr void MakeTables_() {
+    states_count = states_.size();
+    for (int r = 1; r < rules_.size(); ++r) {
+      rules.push_back({rules_[r].lhs - terminals_count_ - 1,
+                       static_cast<int>(rules_[r].rhs.size())});
+    }
+    actions.assign(states_count * classes_count, CELL_ERROR);
+    gotos.assign(states_count * nonterminals_count, 0);
+    consistent_actions.assign(states_count, CELL_ERROR);
+    for (int i = 0; i < states_count; ++i) {
+      Cell* row = actions.data() + i * classes_count;
+      bool has_shifts = false;
+      for (int t = 1; t <= terminals_count_; ++t) {
+        if (transitions_[i][t] != -1) {
+          row[1 + t] = MakeCell(CELL_SHIFT, transitions_[i][t]);
+          has_shifts = true;
+        }
+      }
+      for (int n = 0; n < nonterminals_count; ++n) {
+        gotos[i * nonterminals_count + n] =
+            std::max(transitions_[i][1 + terminals_count_ + n], 0);
+      }
+      std::vector<int> reductions_count(rules_.size(), 0);
+      for (Item item : states_[i]) {
+        if (item.dot != rules_[item.rule].rhs.size()) {
+          continue;
+        }
+        Cell cell = item.rule == 0 ? MakeCell(CELL_ACCEPT, 0) :
+                                     MakeCell(CELL_REDUCE, item.rule - 1);
+        if (row[1 + item.lookahead] != CELL_ERROR) {
+          throw std::invalid_argument("Ambiguous action.");
+        }
+        row[1 + item.lookahead] = cell;
+        has_shifts = has_shifts || item.rule == 0;
+        ++reductions_count[item.rule];
+      }
+      // Default reduction: the most frequent one, the first rule on ties.
+      int default_rule = 0;
+      int distinct_rules = 0;
+      for (int r = 1; r < rules_.size(); ++r) {
+        distinct_rules += reductions_count[r] > 0;
+        if (reductions_count[r] > reductions_count[default_rule]) {
+          default_rule = r;
+        }
+      }
+      if (default_rule == 0) {
+        continue;
+      }
+      for (int j = 0; j < classes_count; ++j) {
+        if (row[j] == CELL_ERROR) {
+          row[j] = MakeCell(CELL_REDUCE, default_rule - 1);
+        }
+      }
+      if (!has_shifts && distinct_rules == 1) {
+        consistent_actions[i] = MakeCell(CELL_REDUCE, default_rule - 1);
+      }
+    }
+  }
+
+  std::vector<Rule> rules_;
+  int terminals_count_ = 0;
+  std::vector<bool> nullable_;
+  std::vector<std::vector<bool>> first_;
+  std::vector<std::vector<Item>> states_;
+  std::vector<std::vector<int>> transitions_;
+};
+
+struct StaticTablesSizes {
+  int states_count;
+  int classes_count;
+  int nonterminals_count;
+  int rules_count;
+};
+
+consteval StaticTablesSizes MeasureStaticTables(std::string_view text) {
+  StaticTablesBuilder builder(text);
+  return {builder.states_count, builder.classes_count,
+          builder.nonterminals_count, static_cast<int>(builder.rules.size())};
+}
+
+template <uint64_t kMaxValue>
+using NarrowestUnsigned = std::conditional_t<
+    kMaxValue <= UINT8_MAX, uint8_t,
+    std::conditional_t<kMaxValue <= UINT16_MAX, uint16_t, uint32_t>>;
+
+template <typename State, typename CellT, StaticTablesSizes kSizes>
+struct StaticTables {
+  std::array<uint8_t, 256> symbol_classes;
+  std::array<CellT, kSizes.states_count * kSizes.classes_count> actions;
+  std::array<State, kSizes.states_count * kSizes.nonterminals_count> gotos;
+  std::array<CellT, kSizes.states_count> consistent_actions;
+  std::array<RuleInfo, kSizes.rules_count> rules;
+};
+
+template <typename State, typename CellT, StaticTablesSizes kSizes>
+consteval StaticTables<State, CellT, kSizes> BuildStaticTables(
+    std::string_view text) {
+  StaticTablesBuilder builder(text);
+  StaticTables<State, CellT, kSizes> tables = {};
+  tables.symbol_classes = builder.symbol_classes;
+  std::copy(builder.actions.begin(), builder.actions.end(),
+            tables.actions.begin());
+  std::copy(builder.gotos.begin(), builder.gotos.end(),
+            tables.gotos.begin());
+  std::copy(builder.consistent_actions.begin(),
+            builder.consistent_actions.end(),
+            tables.consistent_actions.begin());
+  std::copy(builder.rules.begin(), builder.rules.end(), tables.rules.begin());
+  return tables;
+}
+
+// Tables for StaticPredict built during compilation, so that a bad grammar
+// is a compile error:
+//   using Braces = StaticGrammar<"S -> aSbS |">;
+//   static_assert(StaticPredict<Braces>("aabb"));
+template <GrammarLiteral kText>
+struct StaticGrammar {
+  static constexpr StaticTablesSizes kSizes = MeasureStaticTables(kText.View());
+  using State = NarrowestUnsigned<kSizes.states_count>;
+  using CellT = NarrowestUnsigned<MakeCell(
+      CELL_ACCEPT, std::max(kSizes.states_count, kSizes.rules_count))>;
+  static constexpr int states_count = kSizes.states_count;
+  static constexpr int classes_count = kSizes.classes_count;
+  static constexpr int nonterminals_count = kSizes.nonterminals_count;
+  static constexpr auto kTables =
+      BuildStaticTables<State, CellT, kSizes>(kText.View());
+  static constexpr const auto& symbol_classes = kTables.symbol_classes;
+  static constexpr const auto& actions = kTables.actions;
+  static constexpr const auto& gotos = kTables.gotos;
+  static constexpr const auto& consistent_actions = kTables.consistent_actions;
+  static constexpr const auto& rules = kTables.rules;
+};
+
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef LR1PARSER_STATICPARSER_H
+#define LR1PARSER_STATICPARSER_H
+
+
+#include <string_view>
+#include <vector>
+
+#include "ParseTable.h"
+
+// Driver for tables emitted by WriteTablesHeader: Tables provides the State
+// and CellT types, classes_count, nonterminals_count and the symbol_classes,
+// actions, gotos, consistent_actions and rules arrays. Needs no Fit code and
+// also runs in constant expressions. The word ends after its last byte, a NUL
+// inside it is outside of the alphabet.
+template <typename Tables>
+constexpr bool StaticPredict(std::string_view word) {
+  using State = typename Tables::State;
+  using CellT = typename Tables::CellT;
+  std::vector<State> stack{0};
+  size_t pos = 0;
+  while (true) {
+    State state = stack.back();
+    CellT cell = Tables::consistent_actions[state];
+    if (cell == CELL_ERROR) {
+      uint8_t symbol_class = Tables::symbol_classes[0];
+      if (pos < word.size()) {
+        uint8_t symbol = static_cast<uint8_t>(word[pos]);
+        symbol_class = symbol == 0 ? 0 : Tables::symbol_classes[symbol];
+      }
+      cell = Tables::actions[state * Tables::classes_count + symbol_class];
+    }
+    switch (GetCellKind(cell)) {
+      case CELL_ERROR: {
+        return false;
+      }
+      case CELL_SHIFT: {
+        stack.push_back(GetCellPayload(cell));
+        ++pos;
+        break;
+      }
+      case CELL_REDUCE: {
+        const RuleInfo& rule = Tables::rules[GetCellPayload(cell)];
+        stack.resize(stack.size() - rule.length);
+        stack.push_back(Tables::gotos[stack.back() *
+                                      Tables::nonterminals_count + rule.lhs]);
+        break;
+      }
+      case CELL_ACCEPT: {
+        return true;
+      }
+    }
+  }
+}
+
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef LR1PARSER_TABLECACHE_H
+#define LR1PARSER_TABLECACHE_H
+
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Grammar.h"
+#include "LR1Parser.h"
+#include "ParseTable.h"
+
+struct Fingerprint {
+  uint64_t high = 0;
+  uint64_t low = 0;
+  auto operator<=>(const Fingerprint&) const = default;
+  [[nodiscard]] std::string ToString() const;
+};
+
+// Stable across processes and platforms: symbols are hashed in sorted order,
+// rules in grammar order, along with the options that change the tables.
+Fingerprint GetFingerprint(const Grammar& grammar, const FitOptions& options);
+
+// Fitted tables keyed by fingerprint, in memory and, if a directory is
+// given, in files there shared by every process using it. Thread-safe. Files
+// that can't be read or written are skipped, the memory tier still works.
+class TableCache {
+ public:
+  explicit TableCache(std::string directory = "");
+  std::shared_ptr<const ParseTable> Find(const Fingerprint& fingerprint);
+  void Insert(const Fingerprint& fingerprint,
+              std::shared_ptr<const ParseTable> table);
+  [[nodiscard]] size_t GetHitsCount() const;
+  [[nodiscard]] size_t GetMissesCount() const;
+ private:
+  std::string GetPath_(const Fingerprint& fingerprint) const;
+  std::shared_ptr<const ParseTable> ReadFile_(
+      const Fingerprint& fingerprint) const;
+  void WriteFile_(const Fingerprint& fingerprint,
+                  const ParseTable& table) const;
+
+  mutable std::mutex mutex_;
+  std::map<Fingerprint, std::shared_ptr<const ParseTable>> tables_;
+  std::string directory_;
+  size_t hits_count_ = 0;
+  size_t misses_count_ = 0;
+};
+
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef LR1PARSER_TABLEIMAGE_H
+#define LR1PARSER_TABLEIMAGE_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ParseTable.h"
+
+// Position-independent ParseTable: a header followed by 64-byte aligned
+// sections addressed by offsets from the start of the image. An image file
+// can be mapped read-only and parsed from in place, so processes loading the
+// same file share its pages.
+class TableImage {
+ public:
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t state_bytes;
+    uint32_t cell_bytes;
+    uint32_t states_count;
+    uint32_t classes_count;
+    uint32_t nonterminals_count;
+    uint32_t rules_count;
+    uint32_t reserved;
+    uint64_t size;
+    uint64_t symbol_classes_offset;
+    uint64_t actions_offset;
+    uint64_t gotos_offset;
+    uint64_t consistent_actions_offset;
+    uint64_t rules_offset;
+    // Checksum of everything after the header.
+    uint64_t payload_checksum;
+    // Checksum of the fields above.
+    uint64_t header_checksum;
+  };
+
+  TableImage(const TableImage&) = delete;
+  TableImage& operator=(const TableImage&) = delete;
+  ~TableImage();
+
+  // Lays the table out in memory, with the narrowest state and cell types.
+  static std::shared_ptr<const TableImage> Build(const ParseTable& table);
+  // The header is always checked. The payload checksum and the bounds of
+  // every entry only if asked: they touch every page, so without them the
+  // file has to be trusted.
+  static std::shared_ptr<const TableImage> Map(const std::string& path,
+                                               bool verify_payload = true);
+
+  void Write(std::ostream& out) const;
+  [[nodiscard]] const Header& GetHeader() const;
+  [[nodiscard]] bool IsMapped() const;
+  template <typename T>
+  [[nodiscard]] const T* GetSection(uint64_t offset) const {
+    return reinterpret_cast<const T*>(data_ + offset);
+  }
+ private:
+  TableImage() = default;
+  static void Validate_(const std::byte* data, size_t size,
+                        bool verify_payload);
+  static void ValidatePayload_(const std::byte* data, const Header& header);
+
+  std::vector<std::byte> buffer_;
+  const std::byte* data_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+};
+
+
+#endif
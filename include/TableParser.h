@@ -0,0 +1,126 @@
+#ifndef LR1PARSER_TABLEPARSER_H
+#define LR1PARSER_TABLEPARSER_H
+
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "ParseTable.h"
+#include "TableImage.h"
+
+// Type-erased handle over the TableParser specialisations.
+class CompiledParser {
+ public:
+  virtual ~CompiledParser() = default;
+  // The input ends after its last byte, a NUL inside it is an ordinary byte
+  // outside of the alphabet.
+  [[nodiscard]] virtual bool Predict(std::string_view word) const = 0;
+  // Pre-tokenized input with a terminal per token, tokens above 255 are
+  // outside of the alphabet. By default they're narrowed into a buffer.
+  [[nodiscard]] virtual bool Predict(std::span<const uint16_t> tokens) const;
+  [[nodiscard]] virtual size_t GetStateBytes() const = 0;
+  [[nodiscard]] virtual size_t GetCellBytes() const = 0;
+};
+
+// Terminal classes for inputs with an explicit end: the symbol classes of a
+// ParseTable with NUL moved to class 0, next to the other foreign bytes.
+std::array<uint8_t, 256> MakeInputClasses(const uint8_t* symbol_classes);
+
+template <typename Symbol>
+uint8_t GetInputClass(const std::array<uint8_t, 256>& input_classes,
+                      Symbol symbol) {
+  auto value = static_cast<std::make_unsigned_t<Symbol>>(symbol);
+  return value < input_classes.size() ? input_classes[value] : 0;
+}
+
+template <typename StateT>
+class ParseStack {
+ public:
+  void Push(StateT state) {
+    states_.push_back(state);
+  }
+  void Pop(int count) {
+    states_.resize(states_.size() - count);
+  }
+  [[nodiscard]] StateT Top() const {
+    return states_.back();
+  }
+  void Clear() {
+    states_.clear();
+  }
+ private:
+  std::vector<StateT> states_;
+};
+
+// Parses in place from a TableImage with states stored as StateT and action
+// cells as CellT.
+template <typename StateT, typename CellT>
+class TableParser : public CompiledParser {
+ public:
+  explicit TableParser(std::shared_ptr<const TableImage> image);
+  [[nodiscard]] bool Predict(std::string_view word) const override;
+  [[nodiscard]] bool Predict(std::span<const uint16_t> tokens) const override;
+  [[nodiscard]] size_t GetStateBytes() const override;
+  [[nodiscard]] size_t GetCellBytes() const override;
+ protected:
+  template <typename Symbol>
+  bool Parse_(const Symbol* symbol, const Symbol* end) const;
+
+  std::shared_ptr<const TableImage> image_;
+  std::array<uint8_t, 256> input_classes_;
+  uint8_t end_class_;
+  int classes_count_;
+  int nonterminals_count_;
+  const CellT* actions_;
+  const StateT* gotos_;
+  const CellT* consistent_actions_;
+  const RuleInfo* rules_;
+};
+
+template <template <typename, typename> class Parser, typename Base,
+          typename StateT>
+std::unique_ptr<Base> MakeWithCellWidth(
+    std::shared_ptr<const TableImage> image) {
+  switch (image->GetHeader().cell_bytes) {
+    case 1: {
+      return std::make_unique<Parser<StateT, uint8_t>>(std::move(image));
+    }
+    case 2: {
+      return std::make_unique<Parser<StateT, uint16_t>>(std::move(image));
+    }
+    default: {
+      return std::make_unique<Parser<StateT, uint32_t>>(std::move(image));
+    }
+  }
+}
+
+// Instantiates Parser<StateT, CellT> with the widths of the image.
+template <template <typename, typename> class Parser,
+          typename Base = CompiledParser>
+std::unique_ptr<Base> MakeWithImageWidths(
+    std::shared_ptr<const TableImage> image) {
+  switch (image->GetHeader().state_bytes) {
+    case 1: {
+      return MakeWithCellWidth<Parser, Base, uint8_t>(std::move(image));
+    }
+    case 2: {
+      return MakeWithCellWidth<Parser, Base, uint16_t>(std::move(image));
+    }
+    default: {
+      return MakeWithCellWidth<Parser, Base, uint32_t>(std::move(image));
+    }
+  }
+}
+
+// Picks the specialisation matching the widths of the image.
+std::unique_ptr<CompiledParser> MakeCompiledParser(
+    std::shared_ptr<const TableImage> image);
+std::unique_ptr<CompiledParser> MakeCompiledParser(const ParseTable& table);
+
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef LR1PARSER_THREADEDPARSER_H
+#define LR1PARSER_THREADEDPARSER_H
+
+
+#include <memory>
+#include <span>
+#include <string_view>
+
+#include "TableImage.h"
+#include "TableParser.h"
+
+// TableParser with a threaded-code loop: every action handler ends with its
+// own computed goto to the next handler, and the top of the stack is kept
+// out of memory. Falls back to the TableParser loop on compilers without
+// labels as values.
+template <typename StateT, typename CellT>
+class ThreadedParser : public TableParser<StateT, CellT> {
+ public:
+  explicit ThreadedParser(std::shared_ptr<const TableImage> image);
+  [[nodiscard]] bool Predict(std::string_view word) const override;
+  [[nodiscard]] bool Predict(std::span<const uint16_t> tokens) const override;
+ private:
+  template <typename Symbol>
+  bool Parse_(const Symbol* symbol, const Symbol* end) const;
+};
+
+std::unique_ptr<CompiledParser> MakeThreadedParser(
+    std::shared_ptr<const TableImage> image);
+
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef LR1PARSER_WORKSTEALINGPOOL_H
+#define LR1PARSER_WORKSTEALINGPOOL_H
+
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers that run blocks of an index range. Each worker starts
+// with an even share of the blocks and, once it runs out, steals half of the
+// blocks left to another worker, so uneven blocks still balance.
+class WorkStealingPool {
+ public:
+  // Workers besides the calling thread, hardware_concurrency() - 1 if
+  // negative.
+  explicit WorkStealingPool(int threads_count = -1);
+  ~WorkStealingPool();
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+  // Including the calling thread, which is worker 0.
+  [[nodiscard]] int GetWorkersCount() const;
+  // Calls task(begin, end, worker) for the blocks [i * grain, (i + 1) * grain)
+  // covering [0, count) and returns once all of them are done. Runs are
+  // serialized. If blocks throw, the first exception is rethrown once every
+  // worker has stopped, some blocks may not have run.
+  void Run(size_t count, size_t grain,
+           const std::function<void(size_t, size_t, int)>& task);
+  // Shared pool with the default number of workers.
+  static WorkStealingPool& GetShared();
+ private:
+  // Blocks [begin, end) left to a worker, taken from the front by the owner
+  // and from the back by thieves.
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+  void Loop_(int worker);
+  void Work_(int worker);
+  bool Take_(int worker, size_t& block);
+  bool Steal_(int worker);
+
+  std::vector<std::thread> threads_;
+  std::unique_ptr<Queue[]> queues_;
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable finish_;
+  uint64_t generation_ = 0;
+  int busy_count_ = 0;
+  bool stopping_ = false;
+  size_t count_ = 0;
+  size_t grain_ = 1;
+  const std::function<void(size_t, size_t, int)>* task_ = nullptr;
+  std::exception_ptr exception_;
+};
+
+
+#endif
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define LR1PARSER_HAS_AVX2
+#endif
+
+#include "BigramFilter.h"
+
+BigramFilter::BigramFilter(const Grammar& grammar) {
+  Set<char> nonterminals = grammar.GetNonTerminals();
+  std::vector<ProductionRule> production_rules = grammar.GetProductionRules();
+  // Terminals that can start and end a string derived from a symbol, a
+  // terminal derives only itself.
+  std::array<std::bitset<256>, 256> first;
+  std::array<std::bitset<256>, 256> last;
+  std::bitset<256> nullable;
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    if (!nonterminals.contains(static_cast<char>(symbol))) {
+      first[symbol].set(symbol);
+      last[symbol].set(symbol);
+    }
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto& [lhs, rhs] : production_rules) {
+      uint8_t nonterminal = lhs;
+      std::bitset<256> rule_first = first[nonterminal];
+      std::bitset<256> rule_last = last[nonterminal];
+      bool rule_nullable = true;
+      for (uint8_t symbol : rhs) {
+        rule_first |= first[symbol];
+        if (!nullable[symbol]) {
+          rule_nullable = false;
+          break;
+        }
+      }
+      for (auto it = rhs.rbegin(); it != rhs.rend(); ++it) {
+        uint8_t symbol = *it;
+        rule_last |= last[symbol];
+        if (!nullable[symbol]) {
+          break;
+        }
+      }
+      if (rule_first != first[nonterminal] ||
+          rule_last != last[nonterminal] ||
+          (rule_nullable && !nullable[nonterminal])) {
+        first[nonterminal] = rule_first;
+        last[nonterminal] = rule_last;
+        nullable[nonterminal] = nullable[nonterminal] || rule_nullable;
+        changed = true;
+      }
+    }
+  }
+
+  // Neighbouring terminals come from the end of one symbol of a rule and the
+  // start of a later one with only nullable symbols in between.
+  std::array<std::bitset<256>, 256> followers;
+  for (const auto& [lhs, rhs] : production_rules) {
+    for (size_t i = 0; i < rhs.size(); ++i) {
+      for (size_t j = i + 1; j < rhs.size(); ++j) {
+        uint8_t symbol = rhs[j];
+        for (int terminal = 0; terminal < 256; ++terminal) {
+          if (last[static_cast<uint8_t>(rhs[i])][terminal]) {
+            followers[terminal] |= first[symbol];
+          }
+        }
+        if (!nullable[symbol]) {
+          break;
+        }
+      }
+    }
+  }
+
+  for (char terminal : grammar.GetTerminals()) {
+    alphabet_.set(static_cast<uint8_t>(terminal));
+  }
+  uint8_t start = grammar.GetStartSymbol();
+  first_ = first[start] & alphabet_;
+  last_ = last[start] & alphabet_;
+  admits_empty_ = nullable[start];
+  for (int a = 0; a < 256; ++a) {
+    if (!alphabet_[a]) {
+      continue;
+    }
+    for (int b = 0; b < 256; ++b) {
+      if (alphabet_[b] && followers[a][b]) {
+        followers_[a][b / 64] |= uint64_t{1} << (b % 64);
+      }
+    }
+  }
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    if (alphabet_[symbol]) {
+      int row = symbol / 16;
+      auto& rows = row < 8 ? low_rows_ : high_rows_;
+      rows[symbol % 16] |= 1 << (row % 8);
+    }
+  }
+}
+
+bool BigramFilter::Admits(std::string_view word) const {
+  if (word.empty()) {
+    return admits_empty_;
+  }
+  return AdmitsAlphabet_(word) &&
+         AdmitsPairs_(word.data(), word.data() + word.size());
+}
+
+bool BigramFilter::Admits(std::span<const uint16_t> tokens) const {
+  if (tokens.empty()) {
+    return admits_empty_;
+  }
+  for (uint16_t token : tokens) {
+    if (token > 255 || !alphabet_[token]) {
+      return false;
+    }
+  }
+  return AdmitsPairs_(tokens.data(), tokens.data() + tokens.size());
+}
+
+template <typename Symbol>
+bool BigramFilter::AdmitsPairs_(const Symbol* begin, const Symbol* end) const {
+  if (!first_[static_cast<uint8_t>(begin[0])] ||
+      !last_[static_cast<uint8_t>(end[-1])]) {
+    return false;
+  }
+  // Branch-free within a block, so that legal pairs cost a load and an and.
+  const Symbol* pos = begin;
+  while (end - pos > 1) {
+    const Symbol* block_end = pos + std::min<ptrdiff_t>(64, end - pos - 1);
+    uint64_t admitted = 1;
+    for (; pos < block_end; ++pos) {
+      uint8_t a = static_cast<uint8_t>(pos[0]);
+      uint8_t b = static_cast<uint8_t>(pos[1]);
+      admitted &= followers_[a][b / 64] >> (b % 64);
+    }
+    if ((admitted & 1) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BigramFilter::AdmitsAlphabet_(std::string_view word) const {
+#ifdef LR1PARSER_HAS_AVX2
+  if (word.size() >= 32 && __builtin_cpu_supports("avx2")) {
+    return AdmitsAlphabetVectorized_(word);
+  }
+#endif
+  for (char symbol : word) {
+    if (!alphabet_[static_cast<uint8_t>(symbol)]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#ifdef LR1PARSER_HAS_AVX2
+__attribute__((target("avx2")))
+bool BigramFilter::AdmitsAlphabetVectorized_(std::string_view word) const {
+  const __m256i low_rows = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(low_rows_.data())));
+  const __m256i high_rows = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(high_rows_.data())));
+  const __m256i row_bits = _mm256_setr_epi8(
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+  size_t pos = 0;
+  for (; pos + 32 <= word.size(); pos += 32) {
+    __m256i bytes = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(word.data() + pos));
+    __m256i low = _mm256_and_si256(bytes, nibble);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+    // The sign bit of a byte picks the table of its high nibble.
+    __m256i rows = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_rows, low),
+                                      _mm256_shuffle_epi8(high_rows, low),
+                                      bytes);
+    __m256i hits = _mm256_and_si256(rows, _mm256_shuffle_epi8(row_bits, high));
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(hits, zero)) != 0) {
+      return false;
+    }
+  }
+  for (; pos < word.size(); ++pos) {
+    if (!alphabet_[static_cast<uint8_t>(word[pos])]) {
+      return false;
+    }
+  }
+  return true;
+}
+#else
+bool BigramFilter::AdmitsAlphabetVectorized_(std::string_view word) const {
+  throw std::logic_error("AVX2 isn't available.");
+}
+#endif
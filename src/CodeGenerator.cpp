@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "CodeGenerator.h"
+#include "TableParser.h"
+
+static const char* GetTypeName(uint64_t max_value) {
+  if (max_value <= UINT8_MAX) {
+    return "uint8_t";
+  }
+  if (max_value <= UINT16_MAX) {
+    return "uint16_t";
+  }
+  return "uint32_t";
+}
+
+template <typename Values>
+static void WriteArray(std::ostream& out, const char* type, const char* name,
+                       const Values& values) {
+  out << "  static constexpr " << type << " " << name << "[] = {";
+  for (size_t i = 0; i < values.size(); ++i) {
+    out << (i % 16 == 0 ? "\n      " : " ") << +values[i] << ",";
+  }
+  out << "\n  };\n";
+}
+
+static std::string GetGuard(const std::string& name) {
+  if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])) ||
+      !std::all_of(name.begin(), name.end(), [](char symbol) {
+        return std::isalnum(static_cast<unsigned char>(symbol)) ||
+               symbol == '_';
+      })) {
+    throw std::invalid_argument("Bad identifier: " + name);
+  }
+  std::string guard = name;
+  std::transform(guard.begin(), guard.end(), guard.begin(), ::toupper);
+  return "LR1PARSER_GENERATED_" + guard + "_H";
+}
+
+void WriteTablesHeader(std::ostream& out, const ParseTable& table,
+                       const std::string& name) {
+  std::string guard = GetGuard(name);
+  const char* state_type = GetTypeName(table.states_count);
+  const char* cell_type = GetTypeName(MakeCell(
+      CELL_ACCEPT, std::max<int>(table.states_count, table.rules.size())));
+  std::vector<int> gotos;
+  for (int target : table.gotos) {
+    gotos.push_back(std::max(target, 0));
+  }
+
+  out << "// Generated by lr1gen, do not edit.\n"
+      << "#ifndef " << guard << "\n"
+      << "#define " << guard << "\n\n\n"
+      << "#include <cstdint>\n\n"
+      << "#include \"StaticParser.h\"\n\n"
+      << "struct " << name << " {\n"
+      << "  using State = " << state_type << ";\n"
+      << "  using CellT = " << cell_type << ";\n"
+      << "  static constexpr int states_count = " << table.states_count
+      << ";\n"
+      << "  static constexpr int classes_count = " << table.classes_count
+      << ";\n"
+      << "  static constexpr int nonterminals_count = "
+      << table.nonterminals_count << ";\n";
+  WriteArray(out, "uint8_t", "symbol_classes", table.symbol_classes);
+  WriteArray(out, "CellT", "actions", table.actions);
+  WriteArray(out, "State", "gotos", gotos);
+  WriteArray(out, "CellT", "consistent_actions", table.consistent_actions);
+  out << "  static constexpr RuleInfo rules[] = {";
+  for (size_t i = 0; i < table.rules.size(); ++i) {
+    out << (i % 8 == 0 ? "\n      " : " ") << "{" << table.rules[i].lhs
+        << ", " << table.rules[i].length << "},";
+  }
+  out << "\n  };\n"
+      << "};\n\n\n"
+      << "#endif\n";
+  if (!out) {
+    throw std::runtime_error("Failed to write tables header.");
+  }
+}
+
+static void WriteCellCode(std::ostream& out, const ParseTable& table,
+                          Cell cell) {
+  switch (GetCellKind(cell)) {
+    case CELL_ERROR: {
+      out << "return false;\n";
+      break;
+    }
+    case CELL_SHIFT: {
+      out << "++pos; symbol = next_symbol(); goto state_"
+          << GetCellPayload(cell) << ";\n";
+      break;
+    }
+    case CELL_REDUCE: {
+      const RuleInfo& rule = table.rules[GetCellPayload(cell)];
+      if (rule.length > 0) {
+        out << "stack.resize(stack.size() - " << rule.length << "); ";
+      }
+      out << "goto nonterminal_" << rule.lhs << ";\n";
+      break;
+    }
+    case CELL_ACCEPT: {
+      out << "return true;\n";
+      break;
+    }
+  }
+}
+
+// Opens the header and the function up to the first lookahead class.
+static void WriteFunctionStart(std::ostream& out, const ParseTable& table,
+                               const std::string& name,
+                               const std::string& guard) {
+  out << "// Generated by lr1gen, do not edit.\n"
+      << "#ifndef " << guard << "\n"
+      << "#define " << guard << "\n\n\n"
+      << "#include <cstdint>\n"
+      << "#include <string_view>\n"
+      << "#include <vector>\n\n"
+      << "inline bool " << name << "(std::string_view word) {\n";
+  // NUL inside the word is outside of the alphabet.
+  WriteArray(out, "uint8_t", "kSymbolClasses",
+             MakeInputClasses(table.symbol_classes.data()));
+  out << "  thread_local std::vector<" << GetTypeName(table.states_count)
+      << "> stack;\n"
+      << "  stack.clear();\n"
+      << "  size_t pos = 0;\n"
+      << "  auto next_symbol = [&] {\n"
+      << "    return pos < word.size() ?\n"
+      << "           kSymbolClasses[static_cast<uint8_t>(word[pos])] : "
+      << +table.symbol_classes[0] << ";\n"
+      << "  };\n"
+      << "  int symbol = next_symbol();\n";
+}
+
+// Pushes the state and switches on the lookahead class, write_cell writes
+// the statement for each distinct cell.
+template <typename WriteCell>
+static void WriteStateCode(std::ostream& out, const ParseTable& table,
+                           int state, WriteCell write_cell) {
+  out << "  stack.push_back(" << state << ");\n";
+  const Cell* row = table.actions.data() + state * table.classes_count;
+  if (table.consistent_actions[state] != CELL_ERROR) {
+    out << "  ";
+    write_cell(table.consistent_actions[state]);
+    return;
+  }
+  // Class 0 holds the bytes outside of the alphabet, so its cell is the
+  // default action of the state.
+  out << "  switch (symbol) {\n";
+  std::vector<bool> written(table.classes_count, false);
+  for (int j = 1; j < table.classes_count; ++j) {
+    if (written[j] || row[j] == row[0]) {
+      continue;
+    }
+    for (int k = j; k < table.classes_count; ++k) {
+      if (row[k] == row[j]) {
+        out << "    case " << k << ":\n";
+        written[k] = true;
+      }
+    }
+    out << "      ";
+    write_cell(row[j]);
+  }
+  out << "    default:\n      ";
+  write_cell(row[0]);
+  out << "  }\n";
+}
+
+void WriteDirectParser(std::ostream& out, const ParseTable& table,
+                       const std::string& name) {
+  std::string guard = GetGuard(name);
+  std::vector<bool> targets(table.states_count, false);
+  std::vector<bool> reduced(table.nonterminals_count, false);
+  auto mark_cell = [&](Cell cell) {
+    if (GetCellKind(cell) == CELL_SHIFT) {
+      targets[GetCellPayload(cell)] = true;
+    } else if (GetCellKind(cell) == CELL_REDUCE) {
+      reduced[table.rules[GetCellPayload(cell)].lhs] = true;
+    }
+  };
+  for (Cell cell : table.actions) {
+    mark_cell(cell);
+  }
+  for (int target : table.gotos) {
+    if (target != -1) {
+      targets[target] = true;
+    }
+  }
+
+  WriteFunctionStart(out, table, name, guard);
+
+  for (int i = 0; i < table.states_count; ++i) {
+    out << "\n";
+    if (targets[i]) {
+      out << "state_" << i << ":\n";
+    }
+    WriteStateCode(out, table, i, [&](Cell cell) {
+      WriteCellCode(out, table, cell);
+    });
+  }
+
+  for (int j = 0; j < table.nonterminals_count; ++j) {
+    if (!reduced[j]) {
+      continue;
+    }
+    out << "\nnonterminal_" << j << ":\n"
+        << "  switch (stack.back()) {\n";
+    for (int i = 0; i < table.states_count; ++i) {
+      int target = table.gotos[i * table.nonterminals_count + j];
+      if (target != -1) {
+        out << "    case " << i << ": goto state_" << target << ";\n";
+      }
+    }
+    out << "  }\n"
+        << "  return false;\n";
+  }
+  out << "}\n\n\n"
+      << "#endif\n";
+  if (!out) {
+    throw std::runtime_error("Failed to write direct parser.");
+  }
+}
+
+void WriteHybridParser(std::ostream& out, const ParseTable& table,
+                       const std::string& name,
+                       const std::vector<int>& hot_states) {
+  std::string guard = GetGuard(name);
+  std::vector<bool> hot(table.states_count, false);
+  for (int state : hot_states) {
+    if (state < 0 || state >= table.states_count) {
+      throw std::invalid_argument("Bad hot state.");
+    }
+    hot[state] = true;
+  }
+  // Nonterminals reduced by hot code, and whether it enters a cold state,
+  // which jumps to "cold:".
+  std::vector<bool> reduced(table.nonterminals_count, false);
+  bool cold_targets = false;
+  for (int state : hot_states) {
+    for (int j = 0; j < table.classes_count; ++j) {
+      Cell cell = table.actions[state * table.classes_count + j];
+      if (GetCellKind(cell) == CELL_SHIFT) {
+        cold_targets |= !hot[GetCellPayload(cell)];
+      } else if (GetCellKind(cell) == CELL_REDUCE) {
+        reduced[table.rules[GetCellPayload(cell)].lhs] = true;
+      }
+    }
+    Cell cell = table.consistent_actions[state];
+    if (GetCellKind(cell) == CELL_REDUCE) {
+      reduced[table.rules[GetCellPayload(cell)].lhs] = true;
+    }
+  }
+  for (int j = 0; j < table.nonterminals_count; ++j) {
+    for (int i = 0; i < table.states_count && reduced[j]; ++i) {
+      int target = table.gotos[i * table.nonterminals_count + j];
+      cold_targets |= target != -1 && !hot[target];
+    }
+  }
+  std::vector<int> gotos;
+  for (int target : table.gotos) {
+    gotos.push_back(std::max(target, 0));
+  }
+  const char* cell_type = GetTypeName(MakeCell(
+      CELL_ACCEPT, std::max<int>(table.states_count, table.rules.size())));
+
+  WriteFunctionStart(out, table, name, guard);
+  WriteArray(out, cell_type, "kActions", table.actions);
+  WriteArray(out, cell_type, "kConsistentActions", table.consistent_actions);
+  WriteArray(out, GetTypeName(table.states_count), "kGotos", gotos);
+  out << "  static constexpr int kRules[][2] = {";
+  for (size_t i = 0; i < table.rules.size(); ++i) {
+    out << (i % 8 == 0 ? "\n      " : " ") << "{" << table.rules[i].lhs
+        << ", " << table.rules[i].length << "},";
+  }
+  out << "\n  };\n";
+  WriteArray(out, "bool", "kHot", hot);
+  out << "  int state = 0;\n\n"
+      << "enter:\n"
+      << "  switch (state) {\n";
+  for (int state : hot_states) {
+    out << "    case " << state << ": goto state_" << state << ";\n";
+  }
+  // Cells are (payload << 2) | kind, with the kinds in Cell order.
+  out << "  }\n"
+      << (cold_targets ? "cold:\n" : "")
+      << "  while (true) {\n"
+      << "    stack.push_back(state);\n"
+      << "    auto cell = kConsistentActions[state];\n"
+      << "    if (cell == 0) {\n"
+      << "      cell = kActions[state * " << table.classes_count
+      << " + symbol];\n"
+      << "    }\n"
+      << "    switch (cell & 3) {\n"
+      << "      case 0:\n"
+      << "        return false;\n"
+      << "      case 1:\n"
+      << "        state = cell >> 2; ++pos; symbol = next_symbol();\n"
+      << "        break;\n"
+      << "      case 2:\n"
+      << "        stack.resize(stack.size() - kRules[cell >> 2][1]);\n"
+      << "        state = kGotos[stack.back() * " << table.nonterminals_count
+      << " + kRules[cell >> 2][0]];\n"
+      << "        break;\n"
+      << "      default:\n"
+      << "        return true;\n"
+      << "    }\n"
+      << "    if (kHot[state]) {\n"
+      << "      goto enter;\n"
+      << "    }\n"
+      << "  }\n";
+
+  auto write_cell = [&](Cell cell) {
+    switch (GetCellKind(cell)) {
+      case CELL_SHIFT: {
+        int target = GetCellPayload(cell);
+        out << "++pos; symbol = next_symbol(); ";
+        if (hot[target]) {
+          out << "goto state_" << target << ";\n";
+        } else {
+          out << "state = " << target << "; goto cold;\n";
+        }
+        break;
+      }
+      default: {
+        WriteCellCode(out, table, cell);
+        break;
+      }
+    }
+  };
+  for (int state : hot_states) {
+    out << "\nstate_" << state << ":\n";
+    WriteStateCode(out, table, state, write_cell);
+  }
+  for (int j = 0; j < table.nonterminals_count; ++j) {
+    if (!reduced[j]) {
+      continue;
+    }
+    out << "\nnonterminal_" << j << ":\n"
+        << "  switch (stack.back()) {\n";
+    for (int i = 0; i < table.states_count; ++i) {
+      int target = table.gotos[i * table.nonterminals_count + j];
+      if (target == -1) {
+        continue;
+      }
+      out << "    case " << i << ": ";
+      if (hot[target]) {
+        out << "goto state_" << target << ";\n";
+      } else {
+        out << "state = " << target << "; goto cold;\n";
+      }
+    }
+    out << "  }\n"
+        << "  return false;\n";
+  }
+  out << "}\n\n\n"
+      << "#endif\n";
+  if (!out) {
+    throw std::runtime_error("Failed to write hybrid parser.");
+  }
+}
@@ -1,3 +1,7 @@
+#include <cctype>
+#include <istream>
+#include <stdexcept>
+
 #include "Grammar.h"
 
 Set<char> Grammar::GetNonTerminals() const {
@@ -15,3 +19,49 @@ std::vector<ProductionRule> Grammar::GetProductionRules() const {
 char Grammar::GetStartSymbol() const {
   return start_;
 }
+
+
+Grammar ReadGrammar(std::istream& in) {
+  std::vector<ProductionRule> production_rules;
+  Set<char> nonterminals;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string symbols;
+    for (char symbol : line.substr(0, line.find('#'))) {
+      if (!std::isspace(static_cast<unsigned char>(symbol))) {
+        symbols += symbol;
+      }
+    }
+    if (symbols.empty()) {
+      continue;
+    }
+    if (symbols.size() < 3 || symbols.substr(1, 2) != "->") {
+      throw std::invalid_argument("Bad grammar line: " + line);
+    }
+    char lhs = symbols[0];
+    nonterminals.insert(lhs);
+    size_t begin = 3;
+    while (true) {
+      size_t end = symbols.find('|', begin);
+      production_rules.push_back({lhs, symbols.substr(begin, end - begin)});
+      if (end == std::string::npos) {
+        break;
+      }
+      begin = end + 1;
+    }
+  }
+  if (production_rules.empty()) {
+    throw std::invalid_argument("Grammar has no rules.");
+  }
+  Set<char> terminals;
+  for (const auto& production_rule : production_rules) {
+    for (char symbol : production_rule.second) {
+      if (!nonterminals.contains(symbol)) {
+        terminals.insert(symbol);
+      }
+    }
+  }
+  char start = production_rules.front().first;
+  return Grammar(std::move(terminals), std::move(nonterminals),
+                 std::move(production_rules), start);
+}
@@ -0,0 +1,328 @@
+#include <array>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define LR1PARSER_HAS_JIT
+#endif
+
+#include "JitParser.h"
+
+namespace {
+  // Return values of the generated code.
+  enum {
+    JIT_REJECT,
+    JIT_ACCEPT,
+    JIT_OVERFLOW
+  };
+
+  // Machine code with rel32 jumps to labels and 64-bit immediates patched
+  // once the code is placed.
+  class Assembler {
+   public:
+    void Emit(std::initializer_list<uint8_t> bytes) {
+      code_.insert(code_.end(), bytes);
+    }
+    void Emit32(uint32_t value) {
+      for (int i = 0; i < 4; ++i) {
+        code_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+      }
+    }
+    // Emits the opcode followed by a placeholder, returns its offset.
+    size_t Emit64(std::initializer_list<uint8_t> opcode) {
+      Emit(opcode);
+      size_t offset = code_.size();
+      code_.resize(code_.size() + 8);
+      return offset;
+    }
+    // Emits the opcode followed by the displacement to the label.
+    void EmitJump(std::initializer_list<uint8_t> opcode, int label) {
+      Emit(opcode);
+      fixups_.push_back({code_.size(), label});
+      Emit32(0);
+    }
+    int NewLabel() {
+      labels_.push_back(-1);
+      return static_cast<int>(labels_.size()) - 1;
+    }
+    void Bind(int label) {
+      labels_[label] = code_.size();
+    }
+    [[nodiscard]] size_t GetOffset(int label) const {
+      return labels_[label];
+    }
+    std::vector<uint8_t> Finish() {
+      for (const auto& [offset, label] : fixups_) {
+        uint32_t displacement = static_cast<uint32_t>(
+            labels_[label] - static_cast<int64_t>(offset + 4));
+        std::memcpy(code_.data() + offset, &displacement, 4);
+      }
+      return std::move(code_);
+    }
+   private:
+    std::vector<uint8_t> code_;
+    std::vector<int64_t> labels_;
+    std::vector<std::pair<size_t, int>> fixups_;
+  };
+
+  // Register use of the generated code, called as
+  // int parse(const char* word, uint32_t* stack, uint32_t* stack_end,
+  //           const char* word_end):
+  //   rdi - current symbol, rsi - top of the stack, rdx - end of the stack,
+  //   rcx - end of the word, r10 - input classes,
+  //   eax - class of the current symbol, r8, r9 - goto dispatch.
+  class CodeBuilder {
+   public:
+    explicit CodeBuilder(const ParseTable& table): table_(table) {
+      for (int i = 0; i < table_.states_count; ++i) {
+        state_labels_.push_back(assembler_.NewLabel());
+      }
+      for (int j = 0; j < table_.nonterminals_count; ++j) {
+        nonterminal_labels_.push_back(assembler_.NewLabel());
+      }
+      reject_label_ = assembler_.NewLabel();
+      overflow_label_ = assembler_.NewLabel();
+      reduced_.assign(table_.nonterminals_count, false);
+    }
+
+    void Build() {
+      // mov r10, input_classes
+      classes_patch_ = assembler_.Emit64({0x49, 0xBA});
+      EmitLoadClass_();
+      for (int i = 0; i < table_.states_count; ++i) {
+        EmitState_(i);
+      }
+      for (int j = 0; j < table_.nonterminals_count; ++j) {
+        if (reduced_[j]) {
+          EmitNonterminal_(j);
+        }
+      }
+      assembler_.Bind(reject_label_);
+      assembler_.Emit({0x31, 0xC0, 0xC3});  // xor eax, eax; ret
+      assembler_.Bind(overflow_label_);
+      assembler_.Emit({0xB8});  // mov eax, JIT_OVERFLOW; ret
+      assembler_.Emit32(JIT_OVERFLOW);
+      assembler_.Emit({0xC3});
+
+      // The goto jump tables and the symbol classes follow the code.
+      code_ = assembler_.Finish();
+      tables_offset_ = (code_.size() + 7) & ~size_t{7};
+      classes_offset_ = tables_offset_ +
+          table_patches_.size() * table_.states_count * sizeof(uint64_t);
+    }
+
+    [[nodiscard]] size_t GetImageBytes() const {
+      return classes_offset_ + table_.symbol_classes.size();
+    }
+    [[nodiscard]] size_t GetCodeBytes() const {
+      return code_.size();
+    }
+    // Writes the image with every address resolved against base.
+    void WriteImage(uint8_t* base) const {
+      std::memcpy(base, code_.data(), code_.size());
+      auto address = [&](size_t offset) {
+        return reinterpret_cast<uint64_t>(base + offset);
+      };
+      uint64_t classes_address = address(classes_offset_);
+      std::memcpy(base + classes_patch_, &classes_address, 8);
+      size_t offset = tables_offset_;
+      for (const auto& [patch, nonterminal] : table_patches_) {
+        uint64_t table_address = address(offset);
+        std::memcpy(base + patch, &table_address, 8);
+        for (int i = 0; i < table_.states_count; ++i) {
+          int target =
+              table_.gotos[i * table_.nonterminals_count + nonterminal];
+          uint64_t target_address = address(assembler_.GetOffset(
+              target == -1 ? reject_label_ : state_labels_[target]));
+          std::memcpy(base + offset, &target_address, 8);
+          offset += 8;
+        }
+      }
+      std::array<uint8_t, 256> input_classes =
+          MakeInputClasses(table_.symbol_classes.data());
+      std::memcpy(base + classes_offset_, input_classes.data(),
+                  input_classes.size());
+    }
+
+   private:
+    void EmitLoadClass_() {
+      assembler_.Emit({0xB8});  // mov eax, end_class
+      assembler_.Emit32(table_.symbol_classes[0]);
+      assembler_.Emit({0x48, 0x39, 0xCF});  // cmp rdi, rcx
+      assembler_.Emit({0x73, 0x08});  // jae over the loads
+      assembler_.Emit({0x0F, 0xB6, 0x07});  // movzx eax, byte [rdi]
+      // movzx eax, byte [r10 + rax]
+      assembler_.Emit({0x41, 0x0F, 0xB6, 0x04, 0x02});
+    }
+
+    void EmitState_(int state) {
+      assembler_.Bind(state_labels_[state]);
+      assembler_.Emit({0x48, 0x39, 0xD6});  // cmp rsi, rdx
+      assembler_.EmitJump({0x0F, 0x83}, overflow_label_);  // jae
+      assembler_.Emit({0xC7, 0x06});  // mov dword [rsi], state
+      assembler_.Emit32(state);
+      assembler_.Emit({0x48, 0x83, 0xC6, 0x04});  // add rsi, 4
+      if (table_.consistent_actions[state] != CELL_ERROR) {
+        EmitCell_(table_.consistent_actions[state]);
+        return;
+      }
+      // Class 0 holds the bytes outside of the alphabet, so its cell is the
+      // default action of the state.
+      const Cell* row =
+          table_.actions.data() + state * table_.classes_count;
+      std::vector<std::pair<Cell, int>> branches;
+      for (int k = 1; k < table_.classes_count; ++k) {
+        if (row[k] == row[0]) {
+          continue;
+        }
+        int label = -1;
+        for (const auto& [cell, branch_label] : branches) {
+          if (cell == row[k]) {
+            label = branch_label;
+          }
+        }
+        if (label == -1) {
+          label = assembler_.NewLabel();
+          branches.emplace_back(row[k], label);
+        }
+        assembler_.Emit({0x3D});  // cmp eax, k
+        assembler_.Emit32(k);
+        assembler_.EmitJump({0x0F, 0x84}, label);  // je
+      }
+      EmitCell_(row[0]);
+      for (const auto& [cell, label] : branches) {
+        assembler_.Bind(label);
+        EmitCell_(cell);
+      }
+    }
+
+    void EmitCell_(Cell cell) {
+      switch (GetCellKind(cell)) {
+        case CELL_ERROR: {
+          assembler_.EmitJump({0xE9}, reject_label_);
+          break;
+        }
+        case CELL_SHIFT: {
+          assembler_.Emit({0x48, 0xFF, 0xC7});  // inc rdi
+          EmitLoadClass_();
+          assembler_.EmitJump({0xE9}, state_labels_[GetCellPayload(cell)]);
+          break;
+        }
+        case CELL_REDUCE: {
+          const RuleInfo& rule = table_.rules[GetCellPayload(cell)];
+          if (rule.length > 0) {
+            assembler_.Emit({0x48, 0x81, 0xEE});  // sub rsi, 4 * length
+            assembler_.Emit32(4 * rule.length);
+          }
+          reduced_[rule.lhs] = true;
+          assembler_.EmitJump({0xE9}, nonterminal_labels_[rule.lhs]);
+          break;
+        }
+        case CELL_ACCEPT: {
+          assembler_.Emit({0xB8});  // mov eax, JIT_ACCEPT; ret
+          assembler_.Emit32(JIT_ACCEPT);
+          assembler_.Emit({0xC3});
+          break;
+        }
+      }
+    }
+
+    void EmitNonterminal_(int nonterminal) {
+      assembler_.Bind(nonterminal_labels_[nonterminal]);
+      assembler_.Emit({0x44, 0x8B, 0x46, 0xFC});  // mov r8d, [rsi - 4]
+      // mov r9, jump table
+      table_patches_.emplace_back(assembler_.Emit64({0x49, 0xB9}),
+                                  nonterminal);
+      assembler_.Emit({0x43, 0xFF, 0x24, 0xC1});  // jmp [r9 + r8 * 8]
+    }
+
+    const ParseTable& table_;
+    Assembler assembler_;
+    std::vector<int> state_labels_;
+    std::vector<int> nonterminal_labels_;
+    int reject_label_;
+    int overflow_label_;
+    std::vector<bool> reduced_;
+    size_t classes_patch_ = 0;
+    std::vector<std::pair<size_t, int>> table_patches_;
+    std::vector<uint8_t> code_;
+    size_t tables_offset_ = 0;
+    size_t classes_offset_ = 0;
+  };
+}
+
+JitParser::JitParser(const ParseTable& table) {
+#ifdef LR1PARSER_HAS_JIT
+  CodeBuilder builder(table);
+  builder.Build();
+  memory_bytes_ = builder.GetImageBytes();
+  code_bytes_ = builder.GetCodeBytes();
+  memory_ = mmap(nullptr, memory_bytes_, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory_ == MAP_FAILED) {
+    memory_ = nullptr;
+    throw std::runtime_error("Failed to allocate JIT memory.");
+  }
+  builder.WriteImage(static_cast<uint8_t*>(memory_));
+  // Never writable and executable at once.
+  if (mprotect(memory_, memory_bytes_, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory_, memory_bytes_);
+    memory_ = nullptr;
+    throw std::runtime_error("Failed to make JIT memory executable.");
+  }
+  parse_ = reinterpret_cast<int (*)(const char*, uint32_t*, uint32_t*,
+                                    const char*)>(memory_);
+#else
+  throw std::runtime_error("JIT isn't supported on this platform.");
+#endif
+}
+
+JitParser::~JitParser() {
+#ifdef LR1PARSER_HAS_JIT
+  if (memory_ != nullptr) {
+    munmap(memory_, memory_bytes_);
+  }
+#endif
+}
+
+bool JitParser::Predict(std::string_view word) const {
+  thread_local std::vector<uint32_t> stack(256);
+  while (true) {
+    int result = parse_(word.data(), stack.data(), stack.data() + stack.size(),
+                        word.data() + word.size());
+    if (result != JIT_OVERFLOW) {
+      return result == JIT_ACCEPT;
+    }
+    stack.resize(stack.size() * 2);
+  }
+}
+
+size_t JitParser::GetStateBytes() const {
+  return sizeof(uint32_t);
+}
+
+size_t JitParser::GetCellBytes() const {
+  return 0;
+}
+
+size_t JitParser::GetCodeBytes() const {
+  return code_bytes_;
+}
+
+bool JitParser::IsSupported() {
+#ifdef LR1PARSER_HAS_JIT
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::unique_ptr<CompiledParser> MakeJitParser(const ParseTable& table) {
+  if (JitParser::IsSupported()) {
+    return std::make_unique<JitParser>(table);
+  }
+  return MakeCompiledParser(table);
+}
@@ -1,10 +1,53 @@
+#include <algorithm>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <ostream>
 #include <stack>
 #include <stdexcept>
 
 #include "LR1Parser.h"
+#include "TableCache.h"
 
-void LR1Parser::Fit(const Grammar& grammar) {
+LR1Parser::~LR1Parser() {
+  if (native_compilation_.valid()) {
+    native_compilation_.wait();
+  }
+}
+
+void LR1Parser::Fit(const Grammar& grammar, const FitOptions& options) {
   Clear_();
+  options_ = options;
+  // The cache isn't needed after Fit and may not outlive the parser.
+  options_.cache = nullptr;
+  if (options.filter_input) {
+    input_filter_.emplace(grammar);
+  }
+  if (options.cache == nullptr) {
+    MakeActions_(grammar);
+    MakeTable_();
+  } else {
+    Fingerprint fingerprint = GetFingerprint(grammar, options);
+    if (auto table = options.cache->Find(fingerprint)) {
+      table_ = *table;
+    } else {
+      MakeActions_(grammar);
+      MakeTable_();
+      options.cache->Insert(fingerprint,
+                            std::make_shared<const ParseTable>(table_));
+    }
+  }
+  if (options.prefilter_depth > 0) {
+    regular_filter_.emplace(table_, options.prefilter_depth);
+  }
+  if (options.result_cache_capacity > 0) {
+    result_cache_ = std::make_unique<ResultCache>(
+        options.result_cache_capacity);
+  }
+  MakeCompiledParser_();
+}
+
+void LR1Parser::MakeActions_(const Grammar& grammar) {
   Situation end_situation = Init_(grammar);
   MakeStates_(grammar);
   for (int i = 0; i < states_.size(); ++i) {
@@ -23,6 +66,122 @@ void LR1Parser::Fit(const Grammar& grammar) {
       }
     }
   }
+  MakeExpectedTerminals_();
+  MakeDefaultReductions_(end_situation);
+  if (options_.eliminate_unit_rules) {
+    EliminateUnitRules_();
+  }
+}
+
+void LR1Parser::MakeCompiledParser_() {
+  image_ = TableImage::Build(table_);
+  if (options_.backend == TableBackend::PERFECT_HASH) {
+    compiled_parser_ = std::make_shared<PerfectHashParser>(table_);
+  } else if (options_.backend == TableBackend::THREADED) {
+    compiled_parser_ = MakeThreadedParser(image_);
+  } else if (options_.backend == TableBackend::JIT) {
+    compiled_parser_ = MakeJitParser(table_);
+  } else {
+    compiled_parser_ = MakeCompiledParser(image_);
+  }
+  prefix_parser_ = std::make_unique<PrefixSharingParser>(table_);
+  active_parser_.store(compiled_parser_.get(), std::memory_order_release);
+}
+
+const LockstepParser* LR1Parser::GetLockstepParser_() const {
+  if (options_.backend != TableBackend::DENSE || table_.states_count == 0 ||
+      !LockstepParser::IsVectorized()) {
+    return nullptr;
+  }
+  std::lock_guard lock(lockstep_mutex_);
+  if (lockstep_parser_ == nullptr) {
+    lockstep_parser_ = std::make_unique<LockstepParser>(table_);
+  }
+  return lockstep_parser_.get();
+}
+
+static const char kFileMagic[] = {'L', 'R', '1', 'P'};
+static const char kFileVersion = 1;
+
+void LR1Parser::Save(std::ostream& out) const {
+  if (table_.states_count == 0) {
+    throw std::logic_error("Parser has no table to save.");
+  }
+  out.write(kFileMagic, sizeof(kFileMagic));
+  out.put(kFileVersion);
+  out.put(static_cast<char>(options_.backend));
+  out.put(static_cast<char>(options_.eliminate_unit_rules));
+  WriteParseTable(out, table_);
+}
+
+void LR1Parser::Load(std::istream& in) {
+  char magic[sizeof(kFileMagic)] = {};
+  in.read(magic, sizeof(magic));
+  if (!std::equal(magic, magic + sizeof(magic), kFileMagic)) {
+    throw std::runtime_error("Not a parser file.");
+  }
+  if (in.get() != kFileVersion) {
+    throw std::runtime_error("Unsupported parser file version.");
+  }
+  FitOptions options;
+  int backend = in.get();
+  if (backend < static_cast<int>(TableBackend::DENSE) ||
+      backend > static_cast<int>(TableBackend::JIT)) {
+    throw std::runtime_error("Corrupted parser file.");
+  }
+  options.backend = static_cast<TableBackend>(backend);
+  options.eliminate_unit_rules = in.get() == 1;
+  ParseTable table = ReadParseTable(in);
+  Clear_();
+  options_ = options;
+  table_ = std::move(table);
+  MakeCompiledParser_();
+}
+
+void LR1Parser::SaveImage(const std::string& path) const {
+  if (!image_) {
+    throw std::logic_error("Parser isn't fitted.");
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  image_->Write(out);
+}
+
+void LR1Parser::MapImage(const std::string& path, bool verify_payload,
+                         TableBackend backend) {
+  if (backend == TableBackend::PERFECT_HASH || backend == TableBackend::JIT) {
+    throw std::invalid_argument("Only table interpreters can be mapped.");
+  }
+  auto image = TableImage::Map(path, verify_payload);
+  Clear_();
+  options_ = {.backend = backend};
+  image_ = std::move(image);
+  if (backend == TableBackend::THREADED) {
+    compiled_parser_ = MakeThreadedParser(image_);
+  } else {
+    compiled_parser_ = MakeCompiledParser(image_);
+  }
+  active_parser_.store(compiled_parser_.get(), std::memory_order_release);
+}
+
+std::shared_future<void> LR1Parser::CompileNative(
+    const NativeOptions& options) {
+  if (table_.states_count == 0) {
+    throw std::logic_error("Parser has no table to compile.");
+  }
+  if (native_compilation_.valid()) {
+    native_compilation_.wait();
+  }
+  native_compilation_ = std::async(std::launch::async,
+                                   [this, table = table_, options] {
+    auto parser = std::make_shared<NativeParser>(table, options);
+    std::lock_guard lock(native_mutex_);
+    active_parser_.store(parser.get(), std::memory_order_release);
+    if (native_parser_ != nullptr) {
+      retired_parsers_.push_back(std::move(native_parser_));
+    }
+    native_parser_ = std::move(parser);
+  }).share();
+  return native_compilation_;
 }
 
 Situation LR1Parser::Init_(const Grammar& grammar) {
@@ -38,31 +197,155 @@ Situation LR1Parser::Init_(const Grammar& grammar) {
   return end_situation;
 }
 
-bool LR1Parser::Predict(const std::string& word) const {
+bool LR1Parser::Predict(std::string_view word) const {
+  if (result_cache_ == nullptr || word.size() > ResultCache::kMaxWordSize) {
+    return PredictUncached_(word);
+  }
+  if (std::optional<bool> accepted = result_cache_->Find(word)) {
+    return *accepted;
+  }
+  bool accepted = PredictUncached_(word);
+  result_cache_->Insert(word, accepted);
+  return accepted;
+}
+
+bool LR1Parser::PredictUncached_(std::string_view word) const {
+  if (input_filter_ && !input_filter_->Admits(word)) {
+    return false;
+  }
+  if (regular_filter_ && !regular_filter_->Admits(word)) {
+    return false;
+  }
+  const CompiledParser* parser =
+      active_parser_.load(std::memory_order_acquire);
+  return parser != nullptr && parser->Predict(word);
+}
+
+bool LR1Parser::Predict(std::span<const uint16_t> tokens) const {
+  if (input_filter_ && !input_filter_->Admits(tokens)) {
+    return false;
+  }
+  if (regular_filter_ && !regular_filter_->Admits(tokens)) {
+    return false;
+  }
+  const CompiledParser* parser =
+      active_parser_.load(std::memory_order_acquire);
+  return parser != nullptr && parser->Predict(tokens);
+}
+
+std::vector<uint64_t> LR1Parser::PredictBatch(
+    std::string_view buffer, std::span<const size_t> offsets,
+    WorkStealingPool* pool) const {
+  size_t words_count = offsets.empty() ? 0 : offsets.size() - 1;
+  for (size_t i = 0; i < words_count; ++i) {
+    if (offsets[i] > offsets[i + 1] || offsets[i + 1] > buffer.size()) {
+      throw std::invalid_argument("Bad word offsets.");
+    }
+  }
+  std::vector<uint64_t> accepted((words_count + 63) / 64, 0);
+  const CompiledParser* parser =
+      active_parser_.load(std::memory_order_acquire);
+  if (parser == nullptr) {
+    return accepted;
+  }
+  // A block fills whole elements of the result, so workers never share one.
+  const size_t block_words = 64;
+  if (pool == nullptr) {
+    pool = &WorkStealingPool::GetShared();
+  }
+  // Native code beats the lanes, so they're only used while it's not in.
+  const LockstepParser* lockstep =
+      parser == compiled_parser_.get() ? GetLockstepParser_() : nullptr;
+  pool->Run(words_count, block_words, [&](size_t begin, size_t end, int) {
+    if (lockstep != nullptr) {
+      lockstep->Predict(buffer, offsets.subspan(begin, end - begin + 1),
+                        accepted.data() + begin / 64);
+      return;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      if (parser->Predict(
+              buffer.substr(offsets[i], offsets[i + 1] - offsets[i]))) {
+        accepted[i / 64] |= uint64_t{1} << (i % 64);
+      }
+    }
+  });
+  return accepted;
+}
+
+std::vector<uint64_t> LR1Parser::PredictBatchSharingPrefixes(
+    std::string_view buffer, std::span<const size_t> offsets) const {
+  if (prefix_parser_ == nullptr) {
+    return PredictBatch(buffer, offsets);
+  }
+  size_t words_count = offsets.empty() ? 0 : offsets.size() - 1;
+  for (size_t i = 0; i < words_count; ++i) {
+    if (offsets[i] > offsets[i + 1] || offsets[i + 1] > buffer.size()) {
+      throw std::invalid_argument("Bad word offsets.");
+    }
+  }
+  std::vector<uint64_t> accepted((words_count + 63) / 64, 0);
+  prefix_parser_->Predict(buffer, offsets, accepted.data());
+  return accepted;
+}
+
+std::unique_ptr<PushParser> LR1Parser::MakePushParser() const {
+  if (!image_) {
+    throw std::logic_error("Parser isn't fitted.");
+  }
+  return ::MakePushParser(image_);
+}
+
+bool LR1Parser::Predict(std::string_view word, ParseTrace& trace) const {
+  trace = {};
+  return Predict_(word, &trace);
+}
+
+bool LR1Parser::Predict_(std::string_view word, ParseTrace* trace) const {
+  if (states_.empty()) {
+    return false;
+  }
+  // '\0' stands for the end of input here. Inside the word it's outside of
+  // the alphabet, which can only be rejected.
+  if (word.find('\0') != std::string_view::npos) {
+    return false;
+  }
+  auto symbol_at = [&](size_t pos) {
+    return pos < word.size() ? word[pos] : '\0';
+  };
   std::stack<std::pair<char, int>> stack;
   stack.push({'\0', 0});
-  int pos = 0;
-  char current_symbol = word[pos];
+  size_t pos = 0;
+  char current_symbol = symbol_at(pos);
   while (true) {
     int state = stack.top().second;
-    if (!actions_.contains({state, current_symbol})) {
+    const Action* action = FindAction_(state, current_symbol);
+    if (action == nullptr) {
       return false;
     }
-    switch (actions_.at({state, current_symbol}).index()) {
+    switch (action->index()) {
       case SHIFT: {
-        stack.push({current_symbol,
-                    std::get<int>(actions_.at({state, current_symbol}))});
-        current_symbol = word[++pos];
+        stack.push({current_symbol, std::get<int>(*action)});
+        current_symbol = symbol_at(++pos);
         break;
       }
       case REDUCE: {
-        auto production_rule =
-            std::get<ProductionRule>(actions_.at({state, current_symbol}));
+        const auto& production_rule = std::get<ProductionRule>(*action);
         for (int i = 0; i < production_rule.second.size(); ++i) {
           stack.pop();
         }
-        --pos;
-        current_symbol = production_rule.first;
+        std::pair<int, char> goto_key{stack.top().second,
+                                      production_rule.first};
+        stack.push({production_rule.first,
+                    std::get<int>(actions_.at(goto_key))});
+        if (trace != nullptr) {
+          ++trace->reductions;
+          trace->derivation.push_back(production_rule);
+          if (unit_chains_.contains(goto_key)) {
+            const auto& chain = unit_chains_.at(goto_key);
+            trace->derivation.insert(trace->derivation.end(),
+                                     chain.begin(), chain.end());
+          }
+        }
         break;
       }
       case ACCEPT: {
@@ -72,6 +355,293 @@ bool LR1Parser::Predict(const std::string& word) const {
   }
 }
 
+NextTerminals LR1Parser::GetNextTerminals(std::string_view prefix) const {
+  if (states_.empty()) {
+    throw std::logic_error("Parser has no states to predict from.");
+  }
+  // The state after each shift is exact: default reductions only ever run
+  // ahead of an error, never of a shift that canonical tables wouldn't make.
+  std::vector<int> stack = {0};
+  for (size_t pos = 0; pos < prefix.size(); ++pos) {
+    char symbol = prefix[pos];
+    int shifted_state = stack.back();
+    bool shifted = false;
+    while (!shifted && IsTerminal_(symbol)) {
+      const Action* action = FindAction_(stack.back(), symbol);
+      if (action == nullptr || action->index() == ACCEPT) {
+        break;
+      }
+      if (action->index() == SHIFT) {
+        stack.push_back(std::get<int>(*action));
+        shifted = true;
+      } else {
+        const auto& production_rule = std::get<ProductionRule>(*action);
+        stack.resize(stack.size() - production_rule.second.size());
+        stack.push_back(std::get<int>(
+            actions_.at({stack.back(), production_rule.first})));
+      }
+    }
+    if (!shifted) {
+      return {expected_terminals_[shifted_state], pos};
+    }
+  }
+  return {expected_terminals_[stack.back()]};
+}
+
+const Action* LR1Parser::FindAction_(int state, char symbol) const {
+  if (!consistent_states_[state]) {
+    auto it = actions_.find({state, symbol});
+    if (it != actions_.end()) {
+      return &it->second;
+    }
+  }
+  if (default_reductions_[state]) {
+    return &*default_reductions_[state];
+  }
+  return nullptr;
+}
+
+void LR1Parser::MakeExpectedTerminals_() {
+  expected_terminals_.assign(states_.size(), {});
+  for (int i = 0; i < states_.size(); ++i) {
+    for (const auto& situation : states_[i]) {
+      const auto& rhs = situation.production_rule.second;
+      if (situation.next_symbol_index == rhs.size()) {
+        expected_terminals_[i].set(
+            static_cast<uint8_t>(situation.expected_symbol));
+      } else if (IsTerminal_(rhs[situation.next_symbol_index])) {
+        expected_terminals_[i].set(
+            static_cast<uint8_t>(rhs[situation.next_symbol_index]));
+      }
+    }
+  }
+}
+
+void LR1Parser::MakeDefaultReductions_(const Situation& end_situation) {
+  default_reductions_.assign(states_.size(), std::nullopt);
+  consistent_states_.assign(states_.size(), false);
+  for (int i = 0; i < states_.size(); ++i) {
+    if (states_[i].contains(end_situation)) {
+      continue;
+    }
+    std::unordered_map<ProductionRule, int> reductions_count;
+    bool has_shifts = false;
+    for (const auto& situation : states_[i]) {
+      const auto& rhs = situation.production_rule.second;
+      if (situation.next_symbol_index == rhs.size()) {
+        ++reductions_count[situation.production_rule];
+      } else if (IsTerminal_(rhs[situation.next_symbol_index])) {
+        has_shifts = true;
+      }
+    }
+    // The most frequent reduction becomes the default; ties are broken by
+    // rule order so that the tables don't depend on hashing.
+    int max_count = 0;
+    for (const auto& production_rule : production_rules_) {
+      auto it = reductions_count.find(production_rule);
+      if (it != reductions_count.end() && it->second > max_count) {
+        max_count = it->second;
+        default_reductions_[i] = production_rule;
+      }
+    }
+    if (!default_reductions_[i]) {
+      continue;
+    }
+    const auto& default_rule =
+        std::get<ProductionRule>(*default_reductions_[i]);
+    for (const auto& situation : states_[i]) {
+      if (situation.production_rule == default_rule &&
+          situation.next_symbol_index == default_rule.second.size()) {
+        actions_.erase({i, situation.expected_symbol});
+      }
+    }
+    consistent_states_[i] = !has_shifts && reductions_count.size() == 1;
+  }
+}
+
+void LR1Parser::EliminateUnitRules_() {
+  std::unordered_map<std::pair<int, char>, int> new_gotos;
+  for (const auto& [key, action] : actions_) {
+    if (!IsNonTerminal_(key.second)) {
+      continue;
+    }
+    // goto(t, A) lands in a state which can only reduce B -> A, after which
+    // the parser goes to goto(t, B): jump there directly.
+    int target = std::get<int>(action);
+    std::vector<ProductionRule> chain;
+    while (consistent_states_[target] && chain.size() <= nonterminals_.size()) {
+      const auto& production_rule =
+          std::get<ProductionRule>(*default_reductions_[target]);
+      if (production_rule.second.size() != 1) {
+        break;
+      }
+      chain.push_back(production_rule);
+      target = std::get<int>(actions_.at({key.first, production_rule.first}));
+    }
+    if (!chain.empty()) {
+      new_gotos[key] = target;
+      unit_chains_[key] = std::move(chain);
+    }
+  }
+  for (const auto& [key, target] : new_gotos) {
+    actions_[key] = target;
+  }
+}
+
+void LR1Parser::MakeTable_() {
+  std::vector<char> nonterminals(nonterminals_.begin(), nonterminals_.end());
+  std::sort(nonterminals.begin(), nonterminals.end());
+  std::unordered_map<char, int> nonterminal_indices;
+  for (int i = 0; i < nonterminals.size(); ++i) {
+    nonterminal_indices[nonterminals[i]] = i;
+  }
+  // Column 0 stands for every byte outside of the alphabet, column 1 for the
+  // end of input.
+  std::vector<char> terminals(terminals_.begin(), terminals_.end());
+  std::sort(terminals.begin(), terminals.end());
+  terminals.insert(terminals.begin(), '\0');
+
+  // Rules that differ only in their right-hand side symbols reduce alike.
+  table_ = {};
+  std::map<std::pair<int, int>, int> rule_infos;
+  std::unordered_map<ProductionRule, int> rule_indices;
+  for (const auto& production_rule : production_rules_) {
+    RuleInfo rule{nonterminal_indices.at(production_rule.first),
+                  static_cast<int>(production_rule.second.size())};
+    auto [it, inserted] =
+        rule_infos.insert({{rule.lhs, rule.length},
+                           static_cast<int>(table_.rules.size())});
+    if (inserted) {
+      table_.rules.push_back(rule);
+    }
+    rule_indices.insert({production_rule, it->second});
+  }
+  auto make_cell = [&](const Action& action) -> Cell {
+    switch (action.index()) {
+      case SHIFT:
+        return MakeCell(CELL_SHIFT, std::get<int>(action));
+      case REDUCE:
+        return MakeCell(CELL_REDUCE,
+                        rule_indices.at(std::get<ProductionRule>(action)));
+      default:
+        return MakeCell(CELL_ACCEPT, 0);
+    }
+  };
+
+  int states_count = states_.size();
+  std::vector<std::vector<Cell>> rows(states_count);
+  std::vector<std::vector<int>> goto_rows(states_count);
+  for (int i = 0; i < states_count; ++i) {
+    Cell default_cell = CELL_ERROR;
+    if (default_reductions_[i]) {
+      default_cell = make_cell(*default_reductions_[i]);
+    }
+    rows[i].push_back(default_cell);
+    for (char terminal : terminals) {
+      rows[i].push_back(actions_.contains({i, terminal}) ?
+                        make_cell(actions_.at({i, terminal})) : default_cell);
+    }
+    for (char nonterminal : nonterminals) {
+      goto_rows[i].push_back(actions_.contains({i, nonterminal}) ?
+                             std::get<int>(actions_.at({i, nonterminal})) : -1);
+    }
+  }
+
+  // Merge states that behave alike (e.g. after shifting 'x' or 'y' in the
+  // math grammar) by refining a single block until it is stable.
+  std::vector<int> blocks(states_count, 0);
+  auto map_cell = [&](Cell cell) {
+    if (GetCellKind(cell) == CELL_SHIFT) {
+      return MakeCell(CELL_SHIFT, blocks[GetCellPayload(cell)]);
+    }
+    return cell;
+  };
+  for (size_t blocks_count = 1; ; ) {
+    std::map<std::vector<int64_t>, int> signatures;
+    std::vector<int> new_blocks(states_count);
+    for (int i = 0; i < states_count; ++i) {
+      std::vector<int64_t> signature{blocks[i], consistent_states_[i]};
+      for (Cell cell : rows[i]) {
+        signature.push_back(map_cell(cell));
+      }
+      for (int target : goto_rows[i]) {
+        signature.push_back(target == -1 ? -1 : blocks[target]);
+      }
+      new_blocks[i] =
+          signatures.insert({signature, signatures.size()}).first->second;
+    }
+    blocks = std::move(new_blocks);
+    if (signatures.size() == blocks_count) {
+      break;
+    }
+    blocks_count = signatures.size();
+  }
+  std::vector<int> representatives;
+  for (int i = 0; i < states_count; ++i) {
+    if (blocks[i] == representatives.size()) {
+      representatives.push_back(i);
+    }
+  }
+
+  // Terminals whose columns match in every state share a class.
+  std::map<std::vector<Cell>, int> column_classes;
+  std::vector<std::vector<Cell>> columns;
+  for (int j = 0; j < rows.front().size(); ++j) {
+    std::vector<Cell> column;
+    for (int state : representatives) {
+      column.push_back(map_cell(rows[state][j]));
+    }
+    auto [it, inserted] = column_classes.insert({column, columns.size()});
+    if (inserted) {
+      columns.push_back(std::move(column));
+    }
+    if (j > 0) {
+      table_.symbol_classes[static_cast<uint8_t>(terminals[j - 1])] =
+          it->second;
+    }
+  }
+
+  table_.states_count = representatives.size();
+  table_.classes_count = columns.size();
+  table_.nonterminals_count = nonterminals.size();
+  table_.actions.resize(table_.states_count * table_.classes_count);
+  table_.gotos.assign(table_.states_count * table_.nonterminals_count, -1);
+  table_.consistent_actions.assign(table_.states_count, CELL_ERROR);
+  for (int i = 0; i < table_.states_count; ++i) {
+    int state = representatives[i];
+    for (int j = 0; j < table_.classes_count; ++j) {
+      table_.actions[i * table_.classes_count + j] = columns[j][i];
+    }
+    for (int j = 0; j < table_.nonterminals_count; ++j) {
+      if (goto_rows[state][j] != -1) {
+        table_.gotos[i * table_.nonterminals_count + j] =
+            blocks[goto_rows[state][j]];
+      }
+    }
+    if (consistent_states_[state]) {
+      table_.consistent_actions[i] = rows[state].front();
+    }
+  }
+}
+
+const ParseTable& LR1Parser::GetTable() const {
+  return table_;
+}
+
+std::shared_ptr<const CompiledParser> LR1Parser::GetCompiledParser() const {
+  const CompiledParser* parser =
+      active_parser_.load(std::memory_order_acquire);
+  if (parser != compiled_parser_.get()) {
+    std::lock_guard lock(native_mutex_);
+    return native_parser_;
+  }
+  return compiled_parser_;
+}
+
+const ResultCache* LR1Parser::GetResultCache() const {
+  return result_cache_.get();
+}
+
 void LR1Parser::MakeStates_(const Grammar& grammar) {
   auto symbols = nonterminals_;
   symbols.insert(terminals_.begin(), terminals_.end());
@@ -181,9 +751,28 @@ Set<Situation> LR1Parser::Goto_(const Set<Situation>& situations,
 }
 
 void LR1Parser::Clear_() {
+  if (native_compilation_.valid()) {
+    native_compilation_.wait();
+    native_compilation_ = {};
+  }
+  active_parser_.store(nullptr, std::memory_order_release);
+  native_parser_.reset();
+  retired_parsers_.clear();
+  lockstep_parser_.reset();
+  prefix_parser_.reset();
+  input_filter_.reset();
+  regular_filter_.reset();
+  result_cache_.reset();
   actions_.clear();
   states_.clear();
   nonterminals_.clear();
   terminals_.clear();
   production_rules_.clear();
+  default_reductions_.clear();
+  expected_terminals_.clear();
+  consistent_states_.clear();
+  unit_chains_.clear();
+  table_ = {};
+  image_.reset();
+  compiled_parser_.reset();
 }
\ No newline at end of file
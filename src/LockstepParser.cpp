@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define LR1PARSER_HAS_AVX512
+#endif
+
+#include "LockstepParser.h"
+#include "TableParser.h"
+
+namespace {
+  const int kLanesCount = 16;
+  // States per lane stack, longer words are parsed one by one.
+  const int kLaneDepth = 64;
+}
+
+LockstepParser::LockstepParser(const ParseTable& table):
+    end_class_(table.symbol_classes[0]),
+    classes_count_(table.classes_count),
+    nonterminals_count_(table.nonterminals_count),
+    actions_(table.actions.begin(), table.actions.end()),
+    gotos_(table.gotos.begin(), table.gotos.end()),
+    consistent_actions_(table.consistent_actions.begin(),
+                        table.consistent_actions.end()) {
+  std::array<uint8_t, 256> input_classes =
+      MakeInputClasses(table.symbol_classes.data());
+  input_classes_.assign(input_classes.begin(), input_classes.end());
+  for (const RuleInfo& rule : table.rules) {
+    rule_lhs_.push_back(rule.lhs);
+    rule_lengths_.push_back(rule.length);
+  }
+}
+
+void LockstepParser::Predict(std::string_view buffer,
+                             std::span<const size_t> offsets,
+                             uint64_t* accepted) const {
+  size_t words_count = offsets.empty() ? 0 : offsets.size() - 1;
+  std::fill(accepted, accepted + (words_count + 63) / 64, 0);
+  // Positions are 32-bit in the lanes.
+  if (IsVectorized() && buffer.size() < INT32_MAX - 4) {
+    PredictVectorized_(buffer, offsets, accepted);
+    return;
+  }
+  for (size_t i = 0; i < words_count; ++i) {
+    if (PredictWord_(buffer.substr(offsets[i], offsets[i + 1] - offsets[i]))) {
+      accepted[i / 64] |= uint64_t{1} << (i % 64);
+    }
+  }
+}
+
+bool LockstepParser::IsVectorized() {
+#ifdef LR1PARSER_HAS_AVX512
+  return __builtin_cpu_supports("avx512f");
+#else
+  return false;
+#endif
+}
+
+bool LockstepParser::PredictWord_(std::string_view word) const {
+  thread_local std::vector<int32_t> stack;
+  stack.assign(1, 0);
+  size_t pos = 0;
+  while (true) {
+    int32_t state = stack.back();
+    int32_t cell = consistent_actions_[state];
+    if (cell == CELL_ERROR) {
+      int32_t symbol_class = pos < word.size() ?
+          input_classes_[static_cast<uint8_t>(word[pos])] : end_class_;
+      cell = actions_[state * classes_count_ + symbol_class];
+    }
+    switch (GetCellKind(cell)) {
+      case CELL_ERROR: {
+        return false;
+      }
+      case CELL_SHIFT: {
+        stack.push_back(GetCellPayload(cell));
+        ++pos;
+        break;
+      }
+      case CELL_REDUCE: {
+        int32_t rule = GetCellPayload(cell);
+        stack.resize(stack.size() - rule_lengths_[rule]);
+        stack.push_back(
+            gotos_[stack.back() * nonterminals_count_ + rule_lhs_[rule]]);
+        break;
+      }
+      case CELL_ACCEPT: {
+        return true;
+      }
+    }
+  }
+}
+
+#ifdef LR1PARSER_HAS_AVX512
+__attribute__((target("avx512f")))
+void LockstepParser::PredictVectorized_(std::string_view buffer,
+                                        std::span<const size_t> offsets,
+                                        uint64_t* accepted) const {
+  size_t words_count = offsets.empty() ? 0 : offsets.size() - 1;
+  auto set_result = [&](size_t word, bool result) {
+    accepted[word / 64] |= uint64_t{result} << (word % 64);
+  };
+  alignas(64) int32_t states[kLanesCount];
+  alignas(64) int32_t positions[kLanesCount];
+  alignas(64) int32_t ends[kLanesCount];
+  alignas(64) int32_t depths[kLanesCount];
+  alignas(64) int32_t bytes[kLanesCount];
+  size_t words[kLanesCount];
+  // Each lane writes its bottom before reading, so stale contents are fine.
+  thread_local std::vector<int32_t> stacks(kLanesCount * kLaneDepth);
+  size_t next_word = 0;
+  __mmask16 active = 0;
+  // Gives the lane its next short enough word, parsing long ones on the way.
+  auto fill_lane = [&](int lane) {
+    while (next_word < words_count) {
+      size_t word = next_word++;
+      size_t begin = offsets[word];
+      size_t end = offsets[word + 1];
+      if (end - begin >= kLaneDepth / 2) {
+        set_result(word, PredictWord_(buffer.substr(begin, end - begin)));
+        continue;
+      }
+      words[lane] = word;
+      states[lane] = 0;
+      positions[lane] = static_cast<int32_t>(begin);
+      ends[lane] = static_cast<int32_t>(end);
+      depths[lane] = 1;
+      stacks[lane * kLaneDepth] = 0;
+      active |= __mmask16(1u << lane);
+      return;
+    }
+    active &= __mmask16(~(1u << lane));
+  };
+  for (int lane = 0; lane < kLanesCount; ++lane) {
+    fill_lane(lane);
+  }
+
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i kind_mask = _mm512_set1_epi32(3);
+  const __m512i byte_mask = _mm512_set1_epi32(0xFF);
+  const __m512i end_class = _mm512_set1_epi32(end_class_);
+  const __m512i classes_count = _mm512_set1_epi32(classes_count_);
+  const __m512i nonterminals_count = _mm512_set1_epi32(nonterminals_count_);
+  const __m512i buffer_size =
+      _mm512_set1_epi32(static_cast<int32_t>(buffer.size()));
+  const __m512i four = _mm512_set1_epi32(4);
+  const __m512i overflow_depth = _mm512_set1_epi32(kLaneDepth - 1);
+  const __m512i lane_bases = _mm512_mullo_epi32(
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm512_set1_epi32(kLaneDepth));
+  while (active != 0) {
+    __m512i state = _mm512_load_si512(states);
+    __m512i pos = _mm512_load_si512(positions);
+    __m512i depth = _mm512_load_si512(depths);
+
+    // Lookahead classes, the last bytes of the buffer are read one by one so
+    // that the 4-byte gathers stay inside it.
+    __mmask16 in_word =
+        active & _mm512_cmplt_epi32_mask(pos, _mm512_load_si512(ends));
+    __mmask16 gathered = in_word & _mm512_cmple_epi32_mask(
+        _mm512_add_epi32(pos, four), buffer_size);
+    __m512i byte = _mm512_mask_i32gather_epi32(zero, gathered, pos,
+                                               buffer.data(), 1);
+    if (in_word != gathered) {
+      _mm512_store_si512(bytes, byte);
+      for (int lane = 0; lane < kLanesCount; ++lane) {
+        if ((in_word & ~gathered) >> lane & 1) {
+          bytes[lane] = static_cast<uint8_t>(buffer[positions[lane]]);
+        }
+      }
+      byte = _mm512_load_si512(bytes);
+    }
+    byte = _mm512_and_si512(byte, byte_mask);
+    __m512i symbol_class = _mm512_mask_i32gather_epi32(
+        end_class, in_word, byte, input_classes_.data(), 4);
+
+    __m512i cell = _mm512_mask_i32gather_epi32(
+        zero, active, state, consistent_actions_.data(), 4);
+    __mmask16 lookup = active & _mm512_cmpeq_epi32_mask(cell, zero);
+    __m512i index = _mm512_add_epi32(
+        _mm512_mullo_epi32(state, classes_count), symbol_class);
+    cell = _mm512_mask_i32gather_epi32(cell, lookup, index, actions_.data(),
+                                       4);
+    __m512i kind = _mm512_and_si512(cell, kind_mask);
+    __m512i payload = _mm512_srli_epi32(cell, 2);
+    __mmask16 shift = active & _mm512_cmpeq_epi32_mask(
+        kind, _mm512_set1_epi32(CELL_SHIFT));
+    __mmask16 reduce = active & _mm512_cmpeq_epi32_mask(
+        kind, _mm512_set1_epi32(CELL_REDUCE));
+    __mmask16 accept = active & _mm512_cmpeq_epi32_mask(
+        kind, _mm512_set1_epi32(CELL_ACCEPT));
+    __mmask16 error = active & _mm512_cmpeq_epi32_mask(kind, zero);
+
+    _mm512_mask_i32scatter_epi32(stacks.data(), shift,
+                                 _mm512_add_epi32(lane_bases, depth),
+                                 payload, 4);
+    depth = _mm512_mask_add_epi32(depth, shift, depth, one);
+    state = _mm512_mask_mov_epi32(state, shift, payload);
+    pos = _mm512_mask_add_epi32(pos, shift, pos, one);
+
+    __m512i length = _mm512_mask_i32gather_epi32(zero, reduce, payload,
+                                                 rule_lengths_.data(), 4);
+    __m512i lhs = _mm512_mask_i32gather_epi32(zero, reduce, payload,
+                                              rule_lhs_.data(), 4);
+    depth = _mm512_mask_sub_epi32(depth, reduce, depth, length);
+    __m512i top = _mm512_add_epi32(lane_bases, depth);
+    __m512i uncovered = _mm512_mask_i32gather_epi32(
+        zero, reduce, _mm512_sub_epi32(top, one), stacks.data(), 4);
+    __m512i target = _mm512_mask_i32gather_epi32(
+        zero, reduce,
+        _mm512_add_epi32(_mm512_mullo_epi32(uncovered, nonterminals_count),
+                         lhs),
+        gotos_.data(), 4);
+    _mm512_mask_i32scatter_epi32(stacks.data(), reduce, top, target, 4);
+    depth = _mm512_mask_add_epi32(depth, reduce, depth, one);
+    state = _mm512_mask_mov_epi32(state, reduce, target);
+
+    _mm512_store_si512(states, state);
+    _mm512_store_si512(positions, pos);
+    _mm512_store_si512(depths, depth);
+    __mmask16 overflow =
+        active & _mm512_cmpge_epi32_mask(depth, overflow_depth);
+    __mmask16 finished = accept | error | overflow;
+    for (int lane = 0; finished != 0; ++lane, finished >>= 1) {
+      if ((finished & 1) == 0) {
+        continue;
+      }
+      size_t word = words[lane];
+      if (overflow >> lane & 1) {
+        set_result(word, PredictWord_(buffer.substr(
+            offsets[word], offsets[word + 1] - offsets[word])));
+      } else {
+        set_result(word, accept >> lane & 1);
+      }
+      fill_lane(lane);
+    }
+  }
+}
+#else
+void LockstepParser::PredictVectorized_(std::string_view buffer,
+                                        std::span<const size_t> offsets,
+                                        uint64_t* accepted) const {
+  throw std::logic_error("AVX-512 isn't available.");
+}
+#endif
@@ -0,0 +1,112 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#define LR1PARSER_HAS_DLOPEN
+#endif
+
+#include "CodeGenerator.h"
+#include "NativeParser.h"
+
+static const char kEntryPoint[] = "lr1_native_predict";
+
+namespace {
+  // Removes the build directory however the constructor exits.
+  class BuildDirectory {
+   public:
+    BuildDirectory() {
+      std::random_device random;
+      path_ = std::filesystem::temp_directory_path() /
+          ("lr1native-" + std::to_string(random()) + "-" +
+           std::to_string(random()));
+      std::filesystem::create_directories(path_);
+    }
+    ~BuildDirectory() {
+      std::error_code error;
+      std::filesystem::remove_all(path_, error);
+    }
+    [[nodiscard]] std::string GetPath(const std::string& name) const {
+      return (path_ / name).string();
+    }
+   private:
+    std::filesystem::path path_;
+  };
+}
+
+NativeParser::NativeParser(const ParseTable& table,
+                           const NativeOptions& options) {
+  // The same widths as the stack type the generated code picks.
+  state_bytes_ =
+      table.states_count <= std::numeric_limits<uint8_t>::max() ? 1 :
+      table.states_count <= std::numeric_limits<uint16_t>::max() ? 2 : 4;
+#ifdef LR1PARSER_HAS_DLOPEN
+  BuildDirectory directory;
+  std::string source_path = directory.GetPath("parser.cpp");
+  std::string library_path = directory.GetPath("parser.so");
+  std::string log_path = directory.GetPath("compiler.log");
+  {
+    std::ofstream out(source_path);
+    if (options.hot_states.empty()) {
+      WriteDirectParser(out, table, "NativePredict");
+    } else {
+      WriteHybridParser(out, table, "NativePredict", options.hot_states);
+    }
+    out << "extern \"C\" __attribute__((visibility(\"default\"))) bool "
+        << kEntryPoint
+        << "(const char* data, size_t size) {\n"
+        << "  return NativePredict(std::string_view(data, size));\n"
+        << "}\n";
+    if (!out) {
+      throw std::runtime_error("Failed to write native parser source.");
+    }
+  }
+  // Hidden symbols keep the statics of every loaded parser apart.
+  std::string command = options.compiler + " " + options.flags +
+      " -shared -fPIC -fvisibility=hidden -o '" + library_path + "' '" +
+      source_path + "' > '" + log_path + "' 2>&1";
+  if (std::system(command.c_str()) != 0) {
+    std::ostringstream log;
+    log << std::ifstream(log_path).rdbuf();
+    throw std::runtime_error("Failed to compile native parser: " + log.str());
+  }
+  library_ = dlopen(library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (library_ == nullptr) {
+    throw std::runtime_error(std::string("Failed to load native parser: ") +
+                             dlerror());
+  }
+  predict_ = reinterpret_cast<bool (*)(const char*, size_t)>(
+      dlsym(library_, kEntryPoint));
+  if (predict_ == nullptr) {
+    dlclose(library_);
+    throw std::runtime_error("Native parser has no entry point.");
+  }
+#else
+  throw std::runtime_error("Native parsers need dlopen.");
+#endif
+}
+
+NativeParser::~NativeParser() {
+#ifdef LR1PARSER_HAS_DLOPEN
+  if (library_ != nullptr) {
+    dlclose(library_);
+  }
+#endif
+}
+
+bool NativeParser::Predict(std::string_view word) const {
+  return predict_(word.data(), word.size());
+}
+
+size_t NativeParser::GetStateBytes() const {
+  return state_bytes_;
+}
+
+size_t NativeParser::GetCellBytes() const {
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <deque>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+#include "ParseTable.h"
+
+static int GetWidth(uint64_t max_value) {
+  if (max_value <= std::numeric_limits<uint8_t>::max()) {
+    return 1;
+  }
+  if (max_value <= std::numeric_limits<uint16_t>::max()) {
+    return 2;
+  }
+  return 4;
+}
+
+static void WriteValue(std::ostream& out, uint32_t value, int width) {
+  for (int i = 0; i < width; ++i) {
+    out.put(static_cast<char>(value >> (8 * i)));
+  }
+}
+
+static uint32_t ReadValue(std::istream& in, int width) {
+  uint32_t value = 0;
+  for (int i = 0; i < width; ++i) {
+    int byte = in.get();
+    if (byte == std::istream::traits_type::eof()) {
+      throw std::runtime_error("Unexpected end of parse table.");
+    }
+    value |= static_cast<uint32_t>(byte) << (8 * i);
+  }
+  return value;
+}
+
+void WriteParseTable(std::ostream& out, const ParseTable& table) {
+  int state_width = GetWidth(table.states_count + 1);
+  int cell_width = GetWidth(MakeCell(
+      CELL_ACCEPT, std::max<int>(table.states_count, table.rules.size())));
+  WriteValue(out, table.states_count, 4);
+  WriteValue(out, table.classes_count, 4);
+  WriteValue(out, table.nonterminals_count, 4);
+  WriteValue(out, table.rules.size(), 4);
+  for (uint8_t symbol_class : table.symbol_classes) {
+    WriteValue(out, symbol_class, 1);
+  }
+  for (Cell cell : table.actions) {
+    WriteValue(out, cell, cell_width);
+  }
+  // Gotos are shifted by one so that a missing goto is 0.
+  for (int target : table.gotos) {
+    WriteValue(out, target + 1, state_width);
+  }
+  for (Cell cell : table.consistent_actions) {
+    WriteValue(out, cell, cell_width);
+  }
+  for (const RuleInfo& rule : table.rules) {
+    WriteValue(out, rule.lhs, 1);
+    WriteValue(out, rule.length, 4);
+  }
+  if (!out) {
+    throw std::runtime_error("Failed to write parse table.");
+  }
+}
+
+ParseTable ReadParseTable(std::istream& in) {
+  ParseTable table;
+  table.states_count = ReadValue(in, 4);
+  table.classes_count = ReadValue(in, 4);
+  table.nonterminals_count = ReadValue(in, 4);
+  uint32_t rules_count = ReadValue(in, 4);
+  if (table.states_count <= 0 || table.classes_count <= 0 ||
+      table.classes_count > 256 || table.nonterminals_count <= 0 ||
+      table.nonterminals_count > 256 || rules_count > (1 << 24)) {
+    throw std::runtime_error("Corrupted parse table.");
+  }
+  int state_width = GetWidth(table.states_count + 1);
+  int cell_width = GetWidth(MakeCell(
+      CELL_ACCEPT, std::max<int>(table.states_count, rules_count)));
+  auto check_cell = [&](Cell cell) {
+    int payload = GetCellPayload(cell);
+    if ((GetCellKind(cell) == CELL_SHIFT && payload >= table.states_count) ||
+        (GetCellKind(cell) == CELL_REDUCE && payload >= rules_count)) {
+      throw std::runtime_error("Corrupted parse table.");
+    }
+    return cell;
+  };
+
+  for (uint8_t& symbol_class : table.symbol_classes) {
+    symbol_class = ReadValue(in, 1);
+    if (symbol_class >= table.classes_count) {
+      throw std::runtime_error("Corrupted parse table.");
+    }
+  }
+  table.actions.resize(table.states_count * table.classes_count);
+  for (Cell& cell : table.actions) {
+    cell = check_cell(ReadValue(in, cell_width));
+  }
+  table.gotos.resize(table.states_count * table.nonterminals_count);
+  for (int& target : table.gotos) {
+    target = static_cast<int>(ReadValue(in, state_width)) - 1;
+    if (target < -1 || target >= table.states_count) {
+      throw std::runtime_error("Corrupted parse table.");
+    }
+  }
+  table.consistent_actions.resize(table.states_count);
+  for (Cell& cell : table.consistent_actions) {
+    cell = check_cell(ReadValue(in, cell_width));
+  }
+  table.rules.resize(rules_count);
+  for (RuleInfo& rule : table.rules) {
+    rule.lhs = ReadValue(in, 1);
+    rule.length = ReadValue(in, 4);
+    // Keeps the lengths the code generators emit in range, the reductions
+    // themselves are checked against the stacks below.
+    if (rule.lhs >= table.nonterminals_count || rule.length < 0 ||
+        rule.length > table.states_count) {
+      throw std::runtime_error("Corrupted parse table.");
+    }
+  }
+  if (!ReductionsFitStacks(table)) {
+    throw std::runtime_error("Corrupted parse table.");
+  }
+  return table;
+}
+
+bool ReductionsFitStacks(const ParseTable& table) {
+  // Breadth-first, so the first depth found for a state is the smallest.
+  std::vector<int> depths(table.states_count, -1);
+  std::deque<int> queue = {0};
+  depths[0] = 0;
+  auto push = [&](int state, int target) {
+    if (target >= 0 && depths[target] == -1) {
+      depths[target] = depths[state] + 1;
+      queue.push_back(target);
+    }
+  };
+  while (!queue.empty()) {
+    int state = queue.front();
+    queue.pop_front();
+    for (int i = 0; i < table.classes_count; ++i) {
+      Cell cell = table.actions[state * table.classes_count + i];
+      if (GetCellKind(cell) == CELL_SHIFT) {
+        push(state, GetCellPayload(cell));
+      }
+    }
+    for (int i = 0; i < table.nonterminals_count; ++i) {
+      push(state, table.gotos[state * table.nonterminals_count + i]);
+    }
+  }
+  auto fits = [&](int state, Cell cell) {
+    return GetCellKind(cell) != CELL_REDUCE ||
+           table.rules[GetCellPayload(cell)].length <= depths[state];
+  };
+  for (int state = 0; state < table.states_count; ++state) {
+    if (depths[state] == -1) {
+      continue;
+    }
+    for (int i = 0; i < table.classes_count; ++i) {
+      if (!fits(state, table.actions[state * table.classes_count + i])) {
+        return false;
+      }
+    }
+    if (!fits(state, table.consistent_actions[state])) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "PerfectHashParser.h"
+
+PerfectHashParser::PerfectHashParser(const ParseTable& table):
+    input_classes_(MakeInputClasses(table.symbol_classes.data())),
+    end_class_(table.symbol_classes[0]),
+    symbols_count_(table.classes_count + table.nonterminals_count),
+    classes_count_(table.classes_count),
+    consistent_actions_(table.consistent_actions),
+    rules_(table.rules) {
+  // Class 0 holds the bytes outside of the alphabet, so its column is exactly
+  // the default action of each state.
+  std::vector<Slot> entries;
+  for (int i = 0; i < table.states_count; ++i) {
+    Cell default_cell = table.actions[i * table.classes_count];
+    default_actions_.push_back(default_cell);
+    for (int j = 1; j < table.classes_count; ++j) {
+      Cell cell = table.actions[i * table.classes_count + j];
+      if (cell != default_cell) {
+        entries.push_back({static_cast<uint32_t>(i * symbols_count_ + j),
+                           cell});
+      }
+    }
+    for (int j = 0; j < table.nonterminals_count; ++j) {
+      int target = table.gotos[i * table.nonterminals_count + j];
+      if (target != -1) {
+        entries.push_back(
+            {static_cast<uint32_t>(i * symbols_count_ + classes_count_ + j),
+             static_cast<Cell>(target)});
+      }
+    }
+  }
+
+  // Hash and displace: keys are split into buckets, and the largest buckets
+  // pick a seed first that sends all of their keys to free slots.
+  size_t slots_count = std::max<size_t>(entries.size(), 1);
+  seeds_.assign(slots_count / 2 + 1, 0);
+  std::vector<std::vector<Slot>> buckets(seeds_.size());
+  for (const Slot& entry : entries) {
+    buckets[Hash_(entry.key, 0) % buckets.size()].push_back(entry);
+  }
+  std::vector<int> order(buckets.size());
+  for (int i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+    return buckets[lhs].size() > buckets[rhs].size();
+  });
+  // The key of a free slot never matches: keys are below states x symbols.
+  slots_.assign(slots_count, {UINT32_MAX, CELL_ERROR});
+  std::vector<bool> used(slots_count, false);
+  for (int bucket : order) {
+    if (buckets[bucket].empty()) {
+      break;
+    }
+    for (uint32_t seed = 1; ; ++seed) {
+      if (seed == 0) {
+        throw std::runtime_error("Failed to build a perfect hash.");
+      }
+      std::vector<size_t> positions;
+      for (const Slot& entry : buckets[bucket]) {
+        size_t position = Hash_(entry.key, seed) % slots_count;
+        if (used[position] || std::find(positions.begin(), positions.end(),
+                                        position) != positions.end()) {
+          break;
+        }
+        positions.push_back(position);
+      }
+      if (positions.size() != buckets[bucket].size()) {
+        continue;
+      }
+      for (int i = 0; i < positions.size(); ++i) {
+        used[positions[i]] = true;
+        slots_[positions[i]] = buckets[bucket][i];
+      }
+      seeds_[bucket] = seed;
+      break;
+    }
+  }
+}
+
+uint32_t PerfectHashParser::Hash_(uint32_t key, uint32_t seed) {
+  uint64_t hash = (key ^ (static_cast<uint64_t>(seed) << 32)) *
+                  0x9E3779B97F4A7C15ull;
+  hash ^= hash >> 29;
+  hash *= 0xBF58476D1CE4E5B9ull;
+  return static_cast<uint32_t>(hash >> 32);
+}
+
+Cell PerfectHashParser::Find_(int state, int symbol) const {
+  uint32_t key = state * symbols_count_ + symbol;
+  uint32_t seed = seeds_[Hash_(key, 0) % seeds_.size()];
+  const Slot& slot = slots_[Hash_(key, seed) % slots_.size()];
+  return slot.key == key ? slot.cell : default_actions_[state];
+}
+
+bool PerfectHashParser::Predict(std::string_view word) const {
+  return Parse_(word.data(), word.data() + word.size());
+}
+
+bool PerfectHashParser::Predict(std::span<const uint16_t> tokens) const {
+  return Parse_(tokens.data(), tokens.data() + tokens.size());
+}
+
+template <typename Symbol>
+bool PerfectHashParser::Parse_(const Symbol* symbol,
+                               const Symbol* end) const {
+  thread_local ParseStack<uint32_t> stack;
+  stack.Clear();
+  stack.Push(0);
+  while (true) {
+    uint32_t state = stack.Top();
+    Cell cell = consistent_actions_[state];
+    if (cell == CELL_ERROR) {
+      cell = Find_(state, symbol < end ?
+                          GetInputClass(input_classes_, *symbol) : end_class_);
+    }
+    switch (GetCellKind(cell)) {
+      case CELL_ERROR: {
+        return false;
+      }
+      case CELL_SHIFT: {
+        stack.Push(GetCellPayload(cell));
+        ++symbol;
+        break;
+      }
+      case CELL_REDUCE: {
+        const RuleInfo& rule = rules_[GetCellPayload(cell)];
+        stack.Pop(rule.length);
+        stack.Push(Find_(stack.Top(), classes_count_ + rule.lhs));
+        break;
+      }
+      case CELL_ACCEPT: {
+        return true;
+      }
+    }
+  }
+}
+
+size_t PerfectHashParser::GetStateBytes() const {
+  return sizeof(uint32_t);
+}
+
+size_t PerfectHashParser::GetCellBytes() const {
+  return sizeof(Cell);
+}
+
+size_t PerfectHashParser::GetEntriesCount() const {
+  return slots_.size();
+}
@@ -0,0 +1,81 @@
+#include <stdexcept>
+
+#include "PersistentStack.h"
+
+namespace {
+  const size_t kBlockSize = 256;
+}
+
+void StackArena::Reset() {
+  block_index_ = 0;
+  block_used_ = 0;
+  segments_count_ = 0;
+}
+
+size_t StackArena::GetSegmentsCount() const {
+  return segments_count_;
+}
+
+StackArena::Segment* StackArena::Allocate_(Segment* below, uint32_t base) {
+  if (block_index_ == blocks_.size() || block_used_ == kBlockSize) {
+    if (block_index_ < blocks_.size()) {
+      ++block_index_;
+    }
+    if (block_index_ == blocks_.size()) {
+      blocks_.push_back(std::make_unique<Segment[]>(kBlockSize));
+    }
+    block_used_ = 0;
+  }
+  Segment* segment = &blocks_[block_index_][block_used_++];
+  segment->below = below;
+  segment->base = base;
+  segment->used = 0;
+  ++segments_count_;
+  return segment;
+}
+
+PersistentStack PersistentStack::Push(StackArena& arena,
+                                      int32_t state) const {
+  StackArena::Segment* segment = segment_;
+  if (segment != nullptr) {
+    uint32_t offset = size_ - segment->base;
+    if (offset < segment->used && segment->states[offset] == state) {
+      return {segment, size_ + 1};
+    }
+    if (offset == segment->used && offset < StackArena::kSegmentSize) {
+      segment->states[segment->used++] = state;
+      return {segment, size_ + 1};
+    }
+  }
+  segment = arena.Allocate_(segment_, size_);
+  segment->states[0] = state;
+  segment->used = 1;
+  return {segment, size_ + 1};
+}
+
+PersistentStack PersistentStack::Pop(size_t count) const {
+  if (count > size_) {
+    throw std::out_of_range("Popping past the bottom of the stack.");
+  }
+  uint32_t size = size_ - static_cast<uint32_t>(count);
+  StackArena::Segment* segment = segment_;
+  while (segment != nullptr && size <= segment->base) {
+    segment = segment->below;
+  }
+  return {segment, size};
+}
+
+int32_t PersistentStack::Top() const {
+  if (segment_ == nullptr) {
+    throw std::out_of_range("Stack is empty.");
+  }
+  return segment_->states[size_ - segment_->base - 1];
+}
+
+size_t PersistentStack::GetSize() const {
+  return size_;
+}
+
+bool PersistentStack::IsEmpty() const {
+  return size_ == 0;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <numeric>
+
+#include "PersistentStack.h"
+#include "PrefixSharingParser.h"
+#include "TableParser.h"
+
+namespace {
+  // Reduces with the lookahead class and shifts it, returns the kind of the
+  // cell that ended the step.
+  int Step(const ParseTable& table, StackArena& arena, PersistentStack& stack,
+           int symbol_class) {
+    while (true) {
+      int state = stack.Top();
+      Cell cell = table.consistent_actions[state];
+      if (cell == CELL_ERROR) {
+        cell = table.actions[state * table.classes_count + symbol_class];
+      }
+      int kind = GetCellKind(cell);
+      if (kind == CELL_SHIFT) {
+        stack = stack.Push(arena, GetCellPayload(cell));
+        return kind;
+      }
+      if (kind != CELL_REDUCE) {
+        return kind;
+      }
+      const RuleInfo& rule = table.rules[GetCellPayload(cell)];
+      stack = stack.Pop(rule.length);
+      stack = stack.Push(arena, table.gotos[stack.Top() *
+                                            table.nonterminals_count +
+                                            rule.lhs]);
+    }
+  }
+
+  // Three-way radix quicksort on the byte at depth, so that a shared prefix
+  // is compared about once instead of once per comparison of a sort.
+  template <typename WordAt>
+  void SortWords(size_t* begin, size_t* end, size_t depth,
+                 const WordAt& word_at) {
+    auto symbol_at = [&](size_t index) {
+      std::string_view word = word_at(index);
+      return depth < word.size() ? static_cast<uint8_t>(word[depth]) : -1;
+    };
+    while (end - begin > 1) {
+      if (end - begin < 16) {
+        std::sort(begin, end, [&](size_t a, size_t b) {
+          return word_at(a).substr(depth) < word_at(b).substr(depth);
+        });
+        return;
+      }
+      // Skips the prefix the whole group shares in one pass.
+      std::string_view first = word_at(*begin);
+      size_t common = first.size();
+      for (size_t* it = begin + 1; it < end && common > depth; ++it) {
+        std::string_view word = word_at(*it);
+        common = std::mismatch(first.begin() + depth, first.begin() + common,
+                               word.begin() + depth, word.end()).first -
+                 first.begin();
+      }
+      depth = common;
+      int pivot = symbol_at(begin[(end - begin) / 2]);
+      size_t* less = begin;
+      size_t* greater = end;
+      for (size_t* it = begin; it < greater;) {
+        int symbol = symbol_at(*it);
+        if (symbol < pivot) {
+          std::swap(*less++, *it++);
+        } else if (symbol > pivot) {
+          std::swap(*--greater, *it);
+        } else {
+          ++it;
+        }
+      }
+      SortWords(begin, less, depth, word_at);
+      SortWords(greater, end, depth, word_at);
+      if (pivot < 0) {
+        return;
+      }
+      begin = less;
+      end = greater;
+      ++depth;
+    }
+  }
+}
+
+PrefixSharingParser::PrefixSharingParser(const ParseTable& table):
+    table_(table) {}
+
+void PrefixSharingParser::Predict(std::string_view buffer,
+                                  std::span<const size_t> offsets,
+                                  uint64_t* accepted) const {
+  size_t words_count = offsets.empty() ? 0 : offsets.size() - 1;
+  std::fill(accepted, accepted + (words_count + 63) / 64, 0);
+  auto word_at = [&](size_t i) {
+    return buffer.substr(offsets[i], offsets[i + 1] - offsets[i]);
+  };
+  std::vector<size_t> order(words_count);
+  std::iota(order.begin(), order.end(), 0);
+  SortWords(order.data(), order.data() + order.size(), 0, word_at);
+
+  std::array<uint8_t, 256> input_classes =
+      MakeInputClasses(table_.symbol_classes.data());
+  int end_class = table_.symbol_classes[0];
+  thread_local StackArena arena;
+  arena.Reset();
+  // The stack after each shifted symbol of the current path.
+  std::vector<PersistentStack> path = {PersistentStack().Push(arena, 0)};
+  std::string_view previous;
+  // Symbols of the current path up to the first one that can't be shifted.
+  size_t failed_depth = SIZE_MAX;
+  for (size_t index : order) {
+    std::string_view word = word_at(index);
+    size_t shared = std::mismatch(previous.begin(), previous.end(),
+                                  word.begin(), word.end()).first -
+                    previous.begin();
+    previous = word;
+    path.resize(std::min(shared + 1, path.size()));
+    if (failed_depth <= shared) {
+      continue;
+    }
+    failed_depth = SIZE_MAX;
+    PersistentStack stack = path.back();
+    bool rejected = false;
+    for (size_t pos = path.size() - 1; pos < word.size(); ++pos) {
+      int kind = Step(table_, arena, stack,
+                      input_classes[static_cast<uint8_t>(word[pos])]);
+      if (kind != CELL_SHIFT) {
+        failed_depth = pos + 1;
+        rejected = true;
+        break;
+      }
+      path.push_back(stack);
+    }
+    if (!rejected && Step(table_, arena, stack, end_class) == CELL_ACCEPT) {
+      accepted[index / 64] |= uint64_t{1} << (index % 64);
+    }
+  }
+}
@@ -0,0 +1,69 @@
+#include "PushParser.h"
+
+template <typename StateT, typename CellT>
+TablePushParser<StateT, CellT>::TablePushParser(
+    std::shared_ptr<const TableImage> image):
+    TableParser<StateT, CellT>(std::move(image)) {
+  Begin();
+}
+
+template <typename StateT, typename CellT>
+void TablePushParser<StateT, CellT>::Begin() {
+  stack_.Clear();
+  stack_.Push(0);
+  rejected_ = false;
+  accepted_ = false;
+}
+
+template <typename StateT, typename CellT>
+bool TablePushParser<StateT, CellT>::Feed(std::string_view chunk) {
+  for (size_t i = 0; i < chunk.size() && !rejected_; ++i) {
+    rejected_ = !Step_(GetInputClass(this->input_classes_, chunk[i]));
+  }
+  return !rejected_;
+}
+
+template <typename StateT, typename CellT>
+bool TablePushParser<StateT, CellT>::Finish() {
+  if (!rejected_ && !accepted_) {
+    // Accepting is the only way the end of input stops without an error.
+    rejected_ = !Step_(this->end_class_);
+  }
+  return accepted_;
+}
+
+template <typename StateT, typename CellT>
+bool TablePushParser<StateT, CellT>::Step_(uint8_t symbol_class) {
+  while (true) {
+    StateT state = stack_.Top();
+    CellT cell = this->consistent_actions_[state];
+    if (cell == CELL_ERROR) {
+      cell = this->actions_[state * this->classes_count_ + symbol_class];
+    }
+    switch (GetCellKind(cell)) {
+      case CELL_ERROR: {
+        return false;
+      }
+      case CELL_SHIFT: {
+        stack_.Push(GetCellPayload(cell));
+        return true;
+      }
+      case CELL_REDUCE: {
+        const RuleInfo& rule = this->rules_[GetCellPayload(cell)];
+        stack_.Pop(rule.length);
+        stack_.Push(
+            this->gotos_[stack_.Top() * this->nonterminals_count_ + rule.lhs]);
+        break;
+      }
+      case CELL_ACCEPT: {
+        accepted_ = true;
+        return true;
+      }
+    }
+  }
+}
+
+std::unique_ptr<PushParser> MakePushParser(
+    std::shared_ptr<const TableImage> image) {
+  return MakeWithImageWidths<TablePushParser, PushParser>(std::move(image));
+}
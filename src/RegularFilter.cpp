@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+#include "RegularFilter.h"
+#include "TableParser.h"
+
+namespace {
+  // DFA states before minimisation, a deeper cut that needs more is dropped.
+  const int kMaxStatesCount = 4096;
+
+  struct Configuration {
+    // Top of the parse stack, its bottom is state 0 unless it was cut.
+    std::vector<int> stack;
+    bool cut = false;
+    auto operator<=>(const Configuration&) const = default;
+  };
+}
+
+RegularFilter::RegularFilter(const ParseTable& table, int depth):
+    input_classes_(MakeInputClasses(table.symbol_classes.data())),
+    classes_count_(table.classes_count) {
+  if (depth < 1) {
+    throw std::invalid_argument("Depth must be positive.");
+  }
+  while (!Build_(table, depth)) {
+    if (--depth == 0) {
+      throw std::invalid_argument("Grammar is too large to approximate.");
+    }
+  }
+  depth_ = depth;
+  Minimize_();
+}
+
+bool RegularFilter::Admits(std::string_view word) const {
+  int state = start_;
+  for (char symbol : word) {
+    state = transitions_[state * classes_count_ +
+                         input_classes_[static_cast<uint8_t>(symbol)]];
+    if (state == dead_) {
+      return false;
+    }
+  }
+  return accepting_[state];
+}
+
+bool RegularFilter::Admits(std::span<const uint16_t> tokens) const {
+  int state = start_;
+  for (uint16_t token : tokens) {
+    state = transitions_[state * classes_count_ +
+                         GetInputClass(input_classes_, token)];
+    if (state == dead_) {
+      return false;
+    }
+  }
+  return accepting_[state];
+}
+
+int RegularFilter::GetDepth() const {
+  return depth_;
+}
+
+int RegularFilter::GetStatesCount() const {
+  return static_cast<int>(accepting_.size());
+}
+
+bool RegularFilter::Build_(const ParseTable& table, int depth) {
+  std::map<Configuration, int> configuration_ids;
+  std::vector<Configuration> configurations;
+  auto intern = [&](Configuration configuration) {
+    if (configuration.stack.size() > static_cast<size_t>(depth)) {
+      configuration.stack.erase(
+          configuration.stack.begin(),
+          configuration.stack.end() - depth);
+      configuration.cut = true;
+    }
+    auto [it, inserted] = configuration_ids.emplace(configuration,
+                                                    configurations.size());
+    if (inserted) {
+      configurations.push_back(std::move(configuration));
+    }
+    return it->second;
+  };
+  // Reduces a configuration with the lookahead in every way it can, adds the
+  // shifts to shifted and returns whether the lookahead may be accepted.
+  auto step = [&](int id, int symbol_class, std::vector<int>& shifted) {
+    bool accepted = false;
+    std::vector<bool> reached(configurations.size(), false);
+    std::vector<int> pending = {id};
+    while (!pending.empty()) {
+      Configuration configuration = configurations[pending.back()];
+      pending.pop_back();
+      std::vector<int>& stack = configuration.stack;
+      int state = stack.back();
+      Cell cell = table.consistent_actions[state];
+      if (cell == CELL_ERROR) {
+        cell = table.actions[state * table.classes_count + symbol_class];
+      }
+      std::vector<Configuration> reductions;
+      switch (GetCellKind(cell)) {
+        case CELL_ERROR: {
+          break;
+        }
+        case CELL_SHIFT: {
+          stack.push_back(GetCellPayload(cell));
+          shifted.push_back(intern(configuration));
+          break;
+        }
+        case CELL_REDUCE: {
+          const RuleInfo& rule = table.rules[GetCellPayload(cell)];
+          if (stack.size() > static_cast<size_t>(rule.length)) {
+            stack.resize(stack.size() - rule.length);
+            stack.push_back(
+                table.gotos[stack.back() * table.nonterminals_count +
+                            rule.lhs]);
+            reductions.push_back(configuration);
+          } else if (configuration.cut) {
+            for (int uncovered = 0; uncovered < table.states_count;
+                 ++uncovered) {
+              int target = table.gotos[uncovered * table.nonterminals_count +
+                                       rule.lhs];
+              if (target >= 0) {
+                reductions.push_back({{uncovered, target}, true});
+              }
+            }
+          }
+          break;
+        }
+        case CELL_ACCEPT: {
+          accepted = true;
+          break;
+        }
+      }
+      for (auto& reduction : reductions) {
+        int reduced = intern(std::move(reduction));
+        if (static_cast<size_t>(reduced) >= reached.size()) {
+          reached.resize(reduced + 1, false);
+        }
+        if (!reached[reduced]) {
+          reached[reduced] = true;
+          pending.push_back(reduced);
+        }
+      }
+    }
+    return accepted;
+  };
+
+  // Subset construction over the configurations reached after each shift.
+  int end_class = table.symbol_classes[0];
+  std::map<std::vector<int>, int> state_ids;
+  std::vector<std::vector<int>> states;
+  auto add_state = [&](std::vector<int> configurations_set) {
+    std::sort(configurations_set.begin(), configurations_set.end());
+    configurations_set.erase(
+        std::unique(configurations_set.begin(), configurations_set.end()),
+        configurations_set.end());
+    auto [it, inserted] = state_ids.emplace(configurations_set,
+                                            states.size());
+    if (inserted) {
+      states.push_back(std::move(configurations_set));
+    }
+    return it->second;
+  };
+  transitions_.clear();
+  accepting_.clear();
+  start_ = add_state({intern({{0}, false})});
+  for (size_t i = 0; i < states.size(); ++i) {
+    if (states.size() > kMaxStatesCount) {
+      return false;
+    }
+    std::vector<int> configurations_set = states[i];
+    bool accepting = false;
+    std::vector<int> ignored;
+    for (int id : configurations_set) {
+      accepting = step(id, end_class, ignored) || accepting;
+    }
+    accepting_.push_back(accepting);
+    for (int symbol_class = 0; symbol_class < classes_count_;
+         ++symbol_class) {
+      std::vector<int> shifted;
+      if (symbol_class != end_class) {
+        for (int id : configurations_set) {
+          step(id, symbol_class, shifted);
+        }
+      }
+      transitions_.push_back(add_state(std::move(shifted)));
+    }
+  }
+  auto dead = state_ids.find({});
+  dead_ = dead == state_ids.end() ? -1 : dead->second;
+  return true;
+}
+
+void RegularFilter::Minimize_() {
+  // Moore's refinement: states stay together while they agree on accepting
+  // and on the blocks of all their successors.
+  int states_count = static_cast<int>(accepting_.size());
+  std::vector<int> blocks(accepting_.begin(), accepting_.end());
+  int blocks_count = 0;
+  while (true) {
+    std::map<std::vector<int>, int> signatures;
+    std::vector<int> refined(states_count);
+    for (int state = 0; state < states_count; ++state) {
+      std::vector<int> signature = {blocks[state]};
+      for (int symbol_class = 0; symbol_class < classes_count_;
+           ++symbol_class) {
+        signature.push_back(
+            blocks[transitions_[state * classes_count_ + symbol_class]]);
+      }
+      refined[state] = signatures.emplace(std::move(signature),
+                                          signatures.size()).first->second;
+    }
+    blocks = std::move(refined);
+    if (static_cast<int>(signatures.size()) == blocks_count) {
+      break;
+    }
+    blocks_count = static_cast<int>(signatures.size());
+  }
+  std::vector<int32_t> transitions(blocks_count * classes_count_);
+  std::vector<uint8_t> accepting(blocks_count);
+  for (int state = 0; state < states_count; ++state) {
+    for (int symbol_class = 0; symbol_class < classes_count_;
+         ++symbol_class) {
+      transitions[blocks[state] * classes_count_ + symbol_class] =
+          blocks[transitions_[state * classes_count_ + symbol_class]];
+    }
+    accepting[blocks[state]] = accepting_[state];
+  }
+  start_ = blocks[start_];
+  if (dead_ >= 0) {
+    dead_ = blocks[dead_];
+  }
+  transitions_ = std::move(transitions);
+  accepting_ = std::move(accepting);
+}
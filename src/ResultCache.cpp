@@ -0,0 +1,125 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "ResultCache.h"
+
+namespace {
+  uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+  }
+
+  // Eight bytes per multiply, the length keeps prefixes apart.
+  uint64_t HashWord(std::string_view word) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ word.size();
+    size_t pos = 0;
+    for (; pos + 8 <= word.size(); pos += 8) {
+      uint64_t chunk;
+      std::memcpy(&chunk, word.data() + pos, 8);
+      hash = (hash ^ chunk) * 0xC2B2AE3D27D4EB4Full;
+      hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    if (pos < word.size()) {
+      std::memcpy(&tail, word.data() + pos, word.size() - pos);
+    }
+    return Mix(hash ^ tail);
+  }
+}
+
+ResultCache::ResultCache(size_t capacity, int shards_count):
+    shards_(new Shard[shards_count > 0 ? shards_count : 1]),
+    shards_count_(shards_count) {
+  if (capacity == 0 || shards_count <= 0) {
+    throw std::invalid_argument("Capacity and shards must be positive.");
+  }
+  for (int i = 0; i < shards_count; ++i) {
+    // The first shards take the remainder.
+    shards_[i].capacity = capacity / shards_count +
+                          (static_cast<size_t>(i) < capacity % shards_count);
+    shards_[i].entries.reserve(shards_[i].capacity);
+  }
+}
+
+std::optional<bool> ResultCache::Find(std::string_view word) {
+  uint64_t hash = HashWord(word);
+  Shard& shard = GetShard_(hash);
+  std::lock_guard lock(shard.mutex);
+  auto it = shard.indices.find(hash);
+  if (it != shard.indices.end() && shard.entries[it->second].word == word) {
+    Entry& entry = shard.entries[it->second];
+    entry.referenced = true;
+    ++shard.hits_count;
+    return entry.accepted;
+  }
+  ++shard.misses_count;
+  return std::nullopt;
+}
+
+void ResultCache::Insert(std::string_view word, bool accepted) {
+  if (word.size() > kMaxWordSize) {
+    return;
+  }
+  uint64_t hash = HashWord(word);
+  Shard& shard = GetShard_(hash);
+  std::lock_guard lock(shard.mutex);
+  auto it = shard.indices.find(hash);
+  if (it != shard.indices.end()) {
+    Entry& entry = shard.entries[it->second];
+    entry.word.assign(word);
+    entry.accepted = accepted;
+    return;
+  }
+  if (shard.capacity == 0) {
+    return;
+  }
+  if (shard.entries.size() < shard.capacity) {
+    shard.indices.emplace(hash, shard.entries.size());
+    shard.entries.push_back({std::string(word), hash, accepted, false});
+    return;
+  }
+  while (shard.entries[shard.hand].referenced) {
+    shard.entries[shard.hand].referenced = false;
+    shard.hand = (shard.hand + 1) % shard.entries.size();
+  }
+  Entry& victim = shard.entries[shard.hand];
+  shard.indices.erase(victim.hash);
+  shard.indices.emplace(hash, shard.hand);
+  victim.word.assign(word);
+  victim.hash = hash;
+  victim.accepted = accepted;
+  shard.hand = (shard.hand + 1) % shard.entries.size();
+}
+
+size_t ResultCache::GetHitsCount() const {
+  size_t hits_count = 0;
+  for (int i = 0; i < shards_count_; ++i) {
+    std::lock_guard lock(shards_[i].mutex);
+    hits_count += shards_[i].hits_count;
+  }
+  return hits_count;
+}
+
+size_t ResultCache::GetMissesCount() const {
+  size_t misses_count = 0;
+  for (int i = 0; i < shards_count_; ++i) {
+    std::lock_guard lock(shards_[i].mutex);
+    misses_count += shards_[i].misses_count;
+  }
+  return misses_count;
+}
+
+size_t ResultCache::GetSize() const {
+  size_t size = 0;
+  for (int i = 0; i < shards_count_; ++i) {
+    std::lock_guard lock(shards_[i].mutex);
+    size += shards_[i].entries.size();
+  }
+  return size;
+}
+
+ResultCache::Shard& ResultCache::GetShard_(uint64_t hash) const {
+  // The low bits pick the bucket inside the shard's map.
+  return shards_[(hash >> 40) % shards_count_];
+}
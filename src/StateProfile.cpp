@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <numeric>
+
+#include "StateProfile.h"
+#include "TableParser.h"
+
+std::vector<uint64_t> ProfileStates(const ParseTable& table,
+                                    const std::vector<std::string>& samples) {
+  std::vector<uint64_t> profile(table.states_count, 0);
+  std::array<uint8_t, 256> input_classes =
+      MakeInputClasses(table.symbol_classes.data());
+  std::vector<int> stack;
+  for (const auto& sample : samples) {
+    stack.assign(1, 0);
+    ++profile[0];
+    size_t pos = 0;
+    bool finished = false;
+    while (!finished) {
+      int state = stack.back();
+      Cell cell = table.consistent_actions[state];
+      if (cell == CELL_ERROR) {
+        cell = table.actions[state * table.classes_count +
+            (pos < sample.size() ?
+             GetInputClass(input_classes, sample[pos]) :
+             table.symbol_classes[0])];
+      }
+      switch (GetCellKind(cell)) {
+        case CELL_SHIFT: {
+          stack.push_back(GetCellPayload(cell));
+          ++pos;
+          break;
+        }
+        case CELL_REDUCE: {
+          const RuleInfo& rule = table.rules[GetCellPayload(cell)];
+          stack.resize(stack.size() - rule.length);
+          stack.push_back(
+              table.gotos[stack.back() * table.nonterminals_count + rule.lhs]);
+          break;
+        }
+        default: {
+          finished = true;
+          continue;
+        }
+      }
+      ++profile[stack.back()];
+    }
+  }
+  return profile;
+}
+
+std::vector<int> GetHotStates(const std::vector<uint64_t>& profile,
+                              int count) {
+  std::vector<int> states(profile.size());
+  std::iota(states.begin(), states.end(), 0);
+  std::stable_sort(states.begin(), states.end(), [&](int lhs, int rhs) {
+    return profile[lhs] > profile[rhs];
+  });
+  while (!states.empty() && profile[states.back()] == 0) {
+    states.pop_back();
+  }
+  states.resize(std::min<size_t>(states.size(), std::max(count, 0)));
+  return states;
+}
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "TableCache.h"
+
+static const char kCacheMagic[] = {'L', 'R', '1', 'C'};
+static const char kCacheVersion = 1;
+
+namespace {
+  // Two 64-bit lanes with different multipliers, mixed into each other at
+  // the end.
+  class FingerprintBuilder {
+   public:
+    void Add(uint64_t value) {
+      high_ = (high_ ^ value) * 0x9E3779B97F4A7C15ull;
+      high_ ^= high_ >> 32;
+      low_ = (low_ ^ value) * 0xC2B2AE3D27D4EB4Full;
+      low_ ^= low_ >> 29;
+    }
+    Fingerprint Finish() const {
+      return {Mix_(high_ ^ Mix_(low_)), Mix_(low_ + high_)};
+    }
+   private:
+    static uint64_t Mix_(uint64_t value) {
+      value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+      value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+      return value ^ (value >> 31);
+    }
+    uint64_t high_ = 0x6A09E667F3BCC908ull;
+    uint64_t low_ = 0xBB67AE8584CAA73Bull;
+  };
+}
+
+std::string Fingerprint::ToString() const {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string result;
+  for (uint64_t part : {high, low}) {
+    for (int shift = 60; shift >= 0; shift -= 4) {
+      result += kDigits[(part >> shift) & 0xF];
+    }
+  }
+  return result;
+}
+
+Fingerprint GetFingerprint(const Grammar& grammar, const FitOptions& options) {
+  FingerprintBuilder builder;
+  for (const auto& symbols : {grammar.GetTerminals(),
+                              grammar.GetNonTerminals()}) {
+    std::vector<uint8_t> sorted(symbols.begin(), symbols.end());
+    std::sort(sorted.begin(), sorted.end());
+    builder.Add(sorted.size());
+    for (uint8_t symbol : sorted) {
+      builder.Add(symbol);
+    }
+  }
+  builder.Add(static_cast<uint8_t>(grammar.GetStartSymbol()));
+  auto production_rules = grammar.GetProductionRules();
+  builder.Add(production_rules.size());
+  for (const auto& [lhs, rhs] : production_rules) {
+    builder.Add(static_cast<uint8_t>(lhs));
+    builder.Add(rhs.size());
+    for (char symbol : rhs) {
+      builder.Add(static_cast<uint8_t>(symbol));
+    }
+  }
+  // The backend is built from the same table, so it isn't part of the key.
+  builder.Add(options.eliminate_unit_rules);
+  return builder.Finish();
+}
+
+TableCache::TableCache(std::string directory):
+    directory_(std::move(directory)) {
+  if (!directory_.empty()) {
+    std::filesystem::create_directories(directory_);
+  }
+}
+
+std::shared_ptr<const ParseTable> TableCache::Find(
+    const Fingerprint& fingerprint) {
+  {
+    std::lock_guard lock(mutex_);
+    auto it = tables_.find(fingerprint);
+    if (it != tables_.end()) {
+      ++hits_count_;
+      return it->second;
+    }
+  }
+  // Files are read outside the lock, so one grammar doesn't hold up others.
+  std::shared_ptr<const ParseTable> table =
+      directory_.empty() ? nullptr : ReadFile_(fingerprint);
+  std::lock_guard lock(mutex_);
+  if (table == nullptr) {
+    ++misses_count_;
+    return nullptr;
+  }
+  ++hits_count_;
+  // Another thread may have got the same table in the meantime.
+  return tables_.try_emplace(fingerprint, std::move(table)).first->second;
+}
+
+void TableCache::Insert(const Fingerprint& fingerprint,
+                        std::shared_ptr<const ParseTable> table) {
+  if (!directory_.empty()) {
+    WriteFile_(fingerprint, *table);
+  }
+  std::lock_guard lock(mutex_);
+  tables_[fingerprint] = std::move(table);
+}
+
+std::shared_ptr<const ParseTable> TableCache::ReadFile_(
+    const Fingerprint& fingerprint) const {
+  std::ifstream in(GetPath_(fingerprint), std::ios::binary);
+  char header[sizeof(kCacheMagic) + 1] = {};
+  Fingerprint stored;
+  in.read(header, sizeof(header));
+  in.read(reinterpret_cast<char*>(&stored), sizeof(stored));
+  if (!in || !std::equal(kCacheMagic, kCacheMagic + sizeof(kCacheMagic),
+                         header) ||
+      header[sizeof(kCacheMagic)] != kCacheVersion || stored != fingerprint) {
+    return nullptr;
+  }
+  try {
+    return std::make_shared<const ParseTable>(ReadParseTable(in));
+  } catch (const std::runtime_error&) {
+    // A broken file is a miss, the next Insert overwrites it.
+    return nullptr;
+  }
+}
+
+void TableCache::WriteFile_(const Fingerprint& fingerprint,
+                            const ParseTable& table) const {
+  // Readers in other processes only ever see complete files.
+  std::string path = GetPath_(fingerprint);
+  std::string temporary_path =
+      path + "." + std::to_string(std::random_device()()) + ".tmp";
+  bool written = false;
+  {
+    std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+    out.write(kCacheMagic, sizeof(kCacheMagic));
+    out.put(kCacheVersion);
+    out.write(reinterpret_cast<const char*>(&fingerprint),
+              sizeof(fingerprint));
+    try {
+      // Throws if any write so far failed, opening the file included.
+      WriteParseTable(out, table);
+      out.close();
+      written = !out.fail();
+    } catch (const std::runtime_error&) {
+    }
+  }
+  std::error_code error;
+  if (written) {
+    std::filesystem::rename(temporary_path, path, error);
+  }
+  // The disk tier is best-effort, the table is still kept in memory.
+  if (!written || error) {
+    std::filesystem::remove(temporary_path, error);
+  }
+}
+
+size_t TableCache::GetHitsCount() const {
+  std::lock_guard lock(mutex_);
+  return hits_count_;
+}
+
+size_t TableCache::GetMissesCount() const {
+  std::lock_guard lock(mutex_);
+  return misses_count_;
+}
+
+std::string TableCache::GetPath_(const Fingerprint& fingerprint) const {
+  return (std::filesystem::path(directory_) /
+          (fingerprint.ToString() + ".lr1t")).string();
+}
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LR1PARSER_HAS_MMAP
+#endif
+
+#include "TableImage.h"
+
+static const char kImageMagic[] = {'L', 'R', '1', 'I'};
+static const uint32_t kImageVersion = 1;
+static const uint32_t kByteOrder = 0x01020304;
+static const uint64_t kAlignment = 64;
+
+static uint64_t Align(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+static int GetWidth(uint64_t max_value) {
+  if (max_value <= std::numeric_limits<uint8_t>::max()) {
+    return 1;
+  }
+  if (max_value <= std::numeric_limits<uint16_t>::max()) {
+    return 2;
+  }
+  return 4;
+}
+
+// Sizes are multiples of the alignment, so the data is read by 8-byte words.
+static uint64_t Checksum(const std::byte* data, size_t size) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (size_t i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * 0x100000001B3ull;
+    hash ^= hash >> 31;
+  }
+  return hash;
+}
+
+template <typename T>
+static void Store(std::byte* data, uint64_t offset, size_t index, T value) {
+  std::memcpy(data + offset + index * sizeof(T), &value, sizeof(T));
+}
+
+static void StoreValue(std::byte* data, uint64_t offset, size_t index,
+                       uint32_t value, int width) {
+  switch (width) {
+    case 1: {
+      Store<uint8_t>(data, offset, index, value);
+      break;
+    }
+    case 2: {
+      Store<uint16_t>(data, offset, index, value);
+      break;
+    }
+    default: {
+      Store<uint32_t>(data, offset, index, value);
+    }
+  }
+}
+
+static uint32_t LoadValue(const std::byte* data, uint64_t offset, size_t index,
+                          int width) {
+  switch (width) {
+    case 1: {
+      return std::to_integer<uint8_t>(data[offset + index]);
+    }
+    case 2: {
+      uint16_t value;
+      std::memcpy(&value, data + offset + index * sizeof(value),
+                  sizeof(value));
+      return value;
+    }
+    default: {
+      uint32_t value;
+      std::memcpy(&value, data + offset + index * sizeof(value),
+                  sizeof(value));
+      return value;
+    }
+  }
+}
+
+TableImage::~TableImage() {
+#ifdef LR1PARSER_HAS_MMAP
+  if (mapped_) {
+    munmap(const_cast<std::byte*>(data_), size_);
+  }
+#endif
+}
+
+std::shared_ptr<const TableImage> TableImage::Build(const ParseTable& table) {
+  Header header = {};
+  std::memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+  header.version = kImageVersion;
+  header.byte_order = kByteOrder;
+  header.state_bytes = GetWidth(table.states_count);
+  header.cell_bytes = GetWidth(MakeCell(
+      CELL_ACCEPT, std::max<int>(table.states_count, table.rules.size())));
+  header.states_count = table.states_count;
+  header.classes_count = table.classes_count;
+  header.nonterminals_count = table.nonterminals_count;
+  header.rules_count = table.rules.size();
+  header.symbol_classes_offset = Align(sizeof(Header));
+  header.actions_offset =
+      Align(header.symbol_classes_offset + table.symbol_classes.size());
+  header.gotos_offset =
+      Align(header.actions_offset + table.actions.size() * header.cell_bytes);
+  header.consistent_actions_offset =
+      Align(header.gotos_offset + table.gotos.size() * header.state_bytes);
+  header.rules_offset = Align(header.consistent_actions_offset +
+      table.consistent_actions.size() * header.cell_bytes);
+  header.size = Align(header.rules_offset +
+                      table.rules.size() * sizeof(RuleInfo));
+
+  std::shared_ptr<TableImage> image(new TableImage());
+  image->buffer_.assign(header.size, std::byte{0});
+  std::byte* data = image->buffer_.data();
+  std::memcpy(data + header.symbol_classes_offset,
+              table.symbol_classes.data(), table.symbol_classes.size());
+  for (size_t i = 0; i < table.actions.size(); ++i) {
+    StoreValue(data, header.actions_offset, i, table.actions[i],
+               header.cell_bytes);
+  }
+  // Missing gotos are never read, so they don't need a sentinel.
+  for (size_t i = 0; i < table.gotos.size(); ++i) {
+    StoreValue(data, header.gotos_offset, i, std::max(table.gotos[i], 0),
+               header.state_bytes);
+  }
+  for (size_t i = 0; i < table.consistent_actions.size(); ++i) {
+    StoreValue(data, header.consistent_actions_offset, i,
+               table.consistent_actions[i], header.cell_bytes);
+  }
+  for (size_t i = 0; i < table.rules.size(); ++i) {
+    Store(data, header.rules_offset, i, table.rules[i]);
+  }
+  header.payload_checksum =
+      Checksum(data + sizeof(Header), header.size - sizeof(Header));
+  header.header_checksum =
+      Checksum(reinterpret_cast<const std::byte*>(&header),
+               offsetof(Header, header_checksum));
+  std::memcpy(data, &header, sizeof(header));
+  image->data_ = data;
+  image->size_ = header.size;
+  return image;
+}
+
+void TableImage::Validate_(const std::byte* data, size_t size,
+                           bool verify_payload) {
+  if (size < sizeof(Header)) {
+    throw std::runtime_error("Not a table image.");
+  }
+  Header header;
+  std::memcpy(&header, data, sizeof(header));
+  if (!std::equal(kImageMagic, kImageMagic + sizeof(kImageMagic),
+                  header.magic)) {
+    throw std::runtime_error("Not a table image.");
+  }
+  if (header.version != kImageVersion || header.byte_order != kByteOrder) {
+    throw std::runtime_error("Unsupported table image version.");
+  }
+  if (header.header_checksum !=
+      Checksum(data, offsetof(Header, header_checksum))) {
+    throw std::runtime_error("Corrupted table image header.");
+  }
+  auto check_width = [](uint32_t width) {
+    return width == 1 || width == 2 || width == 4;
+  };
+  auto check_section = [&](uint64_t offset, uint64_t length) {
+    return offset % kAlignment == 0 && offset >= sizeof(Header) &&
+           offset <= size && length <= size - offset;
+  };
+  uint64_t states_count = header.states_count;
+  if (header.size != size || !check_width(header.state_bytes) ||
+      !check_width(header.cell_bytes) || states_count == 0 ||
+      header.classes_count == 0 || header.classes_count > 256 ||
+      header.nonterminals_count > 256 || header.rules_count >= (1 << 24) ||
+      states_count >= (1 << 24) ||
+      !check_section(header.symbol_classes_offset, 256) ||
+      !check_section(header.actions_offset,
+                     states_count * header.classes_count * header.cell_bytes) ||
+      !check_section(header.gotos_offset, states_count *
+                     header.nonterminals_count * header.state_bytes) ||
+      !check_section(header.consistent_actions_offset,
+                     states_count * header.cell_bytes) ||
+      !check_section(header.rules_offset,
+                     header.rules_count * sizeof(RuleInfo))) {
+    throw std::runtime_error("Corrupted table image header.");
+  }
+  if (!verify_payload) {
+    return;
+  }
+  if (header.payload_checksum !=
+      Checksum(data + sizeof(Header), size - sizeof(Header))) {
+    throw std::runtime_error("Corrupted table image.");
+  }
+  ValidatePayload_(data, header);
+}
+
+// The parsers index by these values unchecked, so a verified image must not
+// be able to steer them out of the sections or below the bottom of the stack,
+// even if it was built from a bad table and its checksum matches.
+void TableImage::ValidatePayload_(const std::byte* data,
+                                  const Header& header) {
+  ParseTable table;
+  table.states_count = header.states_count;
+  table.classes_count = header.classes_count;
+  table.nonterminals_count = header.nonterminals_count;
+  auto load_cell = [&](uint64_t offset, size_t index) {
+    Cell cell = LoadValue(data, offset, index, header.cell_bytes);
+    uint32_t payload = GetCellPayload(cell);
+    if ((GetCellKind(cell) == CELL_SHIFT && payload >= header.states_count) ||
+        (GetCellKind(cell) == CELL_REDUCE && payload >= header.rules_count)) {
+      throw std::runtime_error("Corrupted table image.");
+    }
+    return cell;
+  };
+  for (size_t i = 0; i < table.symbol_classes.size(); ++i) {
+    table.symbol_classes[i] =
+        std::to_integer<uint8_t>(data[header.symbol_classes_offset + i]);
+    if (table.symbol_classes[i] >= header.classes_count) {
+      throw std::runtime_error("Corrupted table image.");
+    }
+  }
+  table.actions.resize(table.states_count * table.classes_count);
+  for (size_t i = 0; i < table.actions.size(); ++i) {
+    table.actions[i] = load_cell(header.actions_offset, i);
+  }
+  // Missing gotos are stored as 0, which can't lower any depth.
+  table.gotos.resize(table.states_count * table.nonterminals_count);
+  for (size_t i = 0; i < table.gotos.size(); ++i) {
+    table.gotos[i] =
+        LoadValue(data, header.gotos_offset, i, header.state_bytes);
+    if (table.gotos[i] < 0 || table.gotos[i] >= table.states_count) {
+      throw std::runtime_error("Corrupted table image.");
+    }
+  }
+  table.consistent_actions.resize(table.states_count);
+  for (size_t i = 0; i < table.consistent_actions.size(); ++i) {
+    table.consistent_actions[i] =
+        load_cell(header.consistent_actions_offset, i);
+  }
+  table.rules.resize(header.rules_count);
+  for (size_t i = 0; i < table.rules.size(); ++i) {
+    RuleInfo& rule = table.rules[i];
+    std::memcpy(&rule, data + header.rules_offset + i * sizeof(rule),
+                sizeof(rule));
+    if (rule.lhs < 0 || rule.lhs >= table.nonterminals_count ||
+        rule.length < 0 || rule.length > table.states_count) {
+      throw std::runtime_error("Corrupted table image.");
+    }
+  }
+  if (!ReductionsFitStacks(table)) {
+    throw std::runtime_error("Corrupted table image.");
+  }
+}
+
+std::shared_ptr<const TableImage> TableImage::Map(const std::string& path,
+                                                  bool verify_payload) {
+  std::shared_ptr<TableImage> image(new TableImage());
+#ifdef LR1PARSER_HAS_MMAP
+  int file = open(path.c_str(), O_RDONLY);
+  if (file == -1) {
+    throw std::runtime_error("Failed to open " + path + ".");
+  }
+  struct stat file_stat = {};
+  if (fstat(file, &file_stat) == -1 || file_stat.st_size == 0) {
+    close(file);
+    throw std::runtime_error("Failed to map " + path + ".");
+  }
+  void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, file,
+                    0);
+  close(file);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Failed to map " + path + ".");
+  }
+  image->data_ = static_cast<const std::byte*>(data);
+  image->size_ = file_stat.st_size;
+  image->mapped_ = true;
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    throw std::runtime_error("Failed to open " + path + ".");
+  }
+  image->buffer_.resize(file.tellg());
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(image->buffer_.data()),
+            image->buffer_.size());
+  image->data_ = image->buffer_.data();
+  image->size_ = image->buffer_.size();
+#endif
+  Validate_(image->data_, image->size_, verify_payload);
+  return image;
+}
+
+void TableImage::Write(std::ostream& out) const {
+  out.write(reinterpret_cast<const char*>(data_), size_);
+  if (!out) {
+    throw std::runtime_error("Failed to write table image.");
+  }
+}
+
+const TableImage::Header& TableImage::GetHeader() const {
+  return *reinterpret_cast<const Header*>(data_);
+}
+
+bool TableImage::IsMapped() const {
+  return mapped_;
+}
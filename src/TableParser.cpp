@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <string>
+
+#include "TableParser.h"
+
+bool CompiledParser::Predict(std::span<const uint16_t> tokens) const {
+  thread_local std::string word;
+  word.clear();
+  for (uint16_t token : tokens) {
+    // NUL is outside of the alphabet as well.
+    word.push_back(token <= UINT8_MAX ? static_cast<char>(token) : '\0');
+  }
+  return Predict(std::string_view(word));
+}
+
+std::array<uint8_t, 256> MakeInputClasses(const uint8_t* symbol_classes) {
+  std::array<uint8_t, 256> input_classes;
+  std::copy(symbol_classes, symbol_classes + input_classes.size(),
+            input_classes.begin());
+  input_classes[0] = 0;
+  return input_classes;
+}
+
+template <typename StateT, typename CellT>
+TableParser<StateT, CellT>::TableParser(
+    std::shared_ptr<const TableImage> image):
+    image_(std::move(image)) {
+  const TableImage::Header& header = image_->GetHeader();
+  const uint8_t* symbol_classes =
+      image_->GetSection<uint8_t>(header.symbol_classes_offset);
+  input_classes_ = MakeInputClasses(symbol_classes);
+  end_class_ = symbol_classes[0];
+  classes_count_ = header.classes_count;
+  nonterminals_count_ = header.nonterminals_count;
+  actions_ = image_->GetSection<CellT>(header.actions_offset);
+  gotos_ = image_->GetSection<StateT>(header.gotos_offset);
+  consistent_actions_ =
+      image_->GetSection<CellT>(header.consistent_actions_offset);
+  rules_ = image_->GetSection<RuleInfo>(header.rules_offset);
+}
+
+template <typename StateT, typename CellT>
+bool TableParser<StateT, CellT>::Predict(std::string_view word) const {
+  return Parse_(word.data(), word.data() + word.size());
+}
+
+template <typename StateT, typename CellT>
+bool TableParser<StateT, CellT>::Predict(
+    std::span<const uint16_t> tokens) const {
+  return Parse_(tokens.data(), tokens.data() + tokens.size());
+}
+
+template <typename StateT, typename CellT>
+template <typename Symbol>
+bool TableParser<StateT, CellT>::Parse_(const Symbol* symbol,
+                                        const Symbol* end) const {
+  thread_local ParseStack<StateT> stack;
+  stack.Clear();
+  stack.Push(0);
+  while (true) {
+    StateT state = stack.Top();
+    CellT cell = consistent_actions_[state];
+    if (cell == CELL_ERROR) {
+      cell = actions_[state * classes_count_ +
+                      (symbol < end ? GetInputClass(input_classes_, *symbol) :
+                                      end_class_)];
+    }
+    switch (GetCellKind(cell)) {
+      case CELL_ERROR: {
+        return false;
+      }
+      case CELL_SHIFT: {
+        stack.Push(GetCellPayload(cell));
+        ++symbol;
+        break;
+      }
+      case CELL_REDUCE: {
+        const RuleInfo& rule = rules_[GetCellPayload(cell)];
+        stack.Pop(rule.length);
+        stack.Push(gotos_[stack.Top() * nonterminals_count_ + rule.lhs]);
+        break;
+      }
+      case CELL_ACCEPT: {
+        return true;
+      }
+    }
+  }
+}
+
+template <typename StateT, typename CellT>
+size_t TableParser<StateT, CellT>::GetStateBytes() const {
+  return sizeof(StateT);
+}
+
+template <typename StateT, typename CellT>
+size_t TableParser<StateT, CellT>::GetCellBytes() const {
+  return sizeof(CellT);
+}
+
+std::unique_ptr<CompiledParser> MakeCompiledParser(
+    std::shared_ptr<const TableImage> image) {
+  return MakeWithImageWidths<TableParser>(std::move(image));
+}
+
+std::unique_ptr<CompiledParser> MakeCompiledParser(const ParseTable& table) {
+  return MakeCompiledParser(TableImage::Build(table));
+}
+
+template class TableParser<uint8_t, uint8_t>;
+template class TableParser<uint8_t, uint16_t>;
+template class TableParser<uint8_t, uint32_t>;
+template class TableParser<uint16_t, uint8_t>;
+template class TableParser<uint16_t, uint16_t>;
+template class TableParser<uint16_t, uint32_t>;
+template class TableParser<uint32_t, uint8_t>;
+template class TableParser<uint32_t, uint16_t>;
+template class TableParser<uint32_t, uint32_t>;
@@ -0,0 +1,89 @@
+#include <vector>
+
+#include "ThreadedParser.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LR1PARSER_HAS_COMPUTED_GOTO
+#endif
+
+template <typename StateT, typename CellT>
+ThreadedParser<StateT, CellT>::ThreadedParser(
+    std::shared_ptr<const TableImage> image):
+    TableParser<StateT, CellT>(std::move(image)) {}
+
+template <typename StateT, typename CellT>
+bool ThreadedParser<StateT, CellT>::Predict(std::string_view word) const {
+#ifdef LR1PARSER_HAS_COMPUTED_GOTO
+  return Parse_(word.data(), word.data() + word.size());
+#else
+  return TableParser<StateT, CellT>::Predict(word);
+#endif
+}
+
+template <typename StateT, typename CellT>
+bool ThreadedParser<StateT, CellT>::Predict(
+    std::span<const uint16_t> tokens) const {
+#ifdef LR1PARSER_HAS_COMPUTED_GOTO
+  return Parse_(tokens.data(), tokens.data() + tokens.size());
+#else
+  return TableParser<StateT, CellT>::Predict(tokens);
+#endif
+}
+
+#ifdef LR1PARSER_HAS_COMPUTED_GOTO
+template <typename StateT, typename CellT>
+template <typename Symbol>
+bool ThreadedParser<StateT, CellT>::Parse_(const Symbol* symbol,
+                                           const Symbol* end) const {
+  static const void* const kHandlers[] = {&&error, &&shift, &&reduce,
+                                          &&accept};
+  // States below the top one.
+  thread_local std::vector<StateT> stack;
+  stack.clear();
+  StateT state = 0;
+  CellT cell;
+
+#define LR1PARSER_DISPATCH()                                               \
+  cell = this->consistent_actions_[state];                                 \
+  if (cell == CELL_ERROR) {                                                \
+    cell = this->actions_[state * this->classes_count_ +                   \
+                          (symbol < end ?                                  \
+                           GetInputClass(this->input_classes_, *symbol) :  \
+                           this->end_class_)];                             \
+  }                                                                        \
+  goto *kHandlers[GetCellKind(cell)]
+
+  LR1PARSER_DISPATCH();
+
+shift:
+  stack.push_back(state);
+  state = GetCellPayload(cell);
+  ++symbol;
+  LR1PARSER_DISPATCH();
+
+reduce: {
+    const RuleInfo& rule = this->rules_[GetCellPayload(cell)];
+    // The uncovered state stays on the stack under the goto target.
+    if (rule.length == 0) {
+      stack.push_back(state);
+    } else {
+      stack.resize(stack.size() - rule.length + 1);
+    }
+    state = this->gotos_[stack.back() * this->nonterminals_count_ + rule.lhs];
+  }
+  LR1PARSER_DISPATCH();
+
+#undef LR1PARSER_DISPATCH
+
+error:
+  return false;
+
+accept:
+  return true;
+}
+#endif
+
+std::unique_ptr<CompiledParser> MakeThreadedParser(
+    std::shared_ptr<const TableImage> image) {
+  return MakeWithImageWidths<ThreadedParser>(std::move(image));
+}
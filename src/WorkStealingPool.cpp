@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <utility>
+
+#include "WorkStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(int threads_count) {
+  if (threads_count < 0) {
+    threads_count =
+        std::max(1u, std::thread::hardware_concurrency()) - 1;
+  }
+  queues_ = std::make_unique<Queue[]>(threads_count + 1);
+  for (int i = 1; i <= threads_count; ++i) {
+    threads_.emplace_back([this, i] {
+      Loop_(i);
+    });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  start_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+int WorkStealingPool::GetWorkersCount() const {
+  return static_cast<int>(threads_.size()) + 1;
+}
+
+void WorkStealingPool::Run(
+    size_t count, size_t grain,
+    const std::function<void(size_t, size_t, int)>& task) {
+  std::lock_guard run_lock(run_mutex_);
+  grain = std::max<size_t>(grain, 1);
+  size_t blocks_count = (count + grain - 1) / grain;
+  int workers_count = GetWorkersCount();
+  for (int i = 0; i < workers_count; ++i) {
+    std::lock_guard lock(queues_[i].mutex);
+    queues_[i].begin = blocks_count * i / workers_count;
+    queues_[i].end = blocks_count * (i + 1) / workers_count;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    count_ = count;
+    grain_ = grain;
+    task_ = &task;
+    busy_count_ = workers_count - 1;
+    ++generation_;
+  }
+  start_.notify_all();
+  Work_(0);
+  // The task must outlive every worker that may still call it.
+  std::unique_lock lock(mutex_);
+  finish_.wait(lock, [this] {
+    return busy_count_ == 0;
+  });
+  task_ = nullptr;
+  if (exception_) {
+    std::rethrow_exception(std::exchange(exception_, nullptr));
+  }
+}
+
+WorkStealingPool& WorkStealingPool::GetShared() {
+  static WorkStealingPool pool;
+  return pool;
+}
+
+void WorkStealingPool::Loop_(int worker) {
+  uint64_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock lock(mutex_);
+      start_.wait(lock, [&] {
+        return stopping_ || generation_ != generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      generation = generation_;
+    }
+    Work_(worker);
+    {
+      std::lock_guard lock(mutex_);
+      --busy_count_;
+    }
+    finish_.notify_one();
+  }
+}
+
+void WorkStealingPool::Work_(int worker) {
+  size_t block;
+  try {
+    while (Take_(worker, block) || (Steal_(worker) && Take_(worker, block))) {
+      size_t begin = block * grain_;
+      (*task_)(begin, std::min(begin + grain_, count_), worker);
+    }
+  } catch (...) {
+    // This worker stops, the others may still take its blocks.
+    std::lock_guard lock(mutex_);
+    if (!exception_) {
+      exception_ = std::current_exception();
+    }
+  }
+}
+
+bool WorkStealingPool::Take_(int worker, size_t& block) {
+  Queue& queue = queues_[worker];
+  std::lock_guard lock(queue.mutex);
+  if (queue.begin == queue.end) {
+    return false;
+  }
+  block = queue.begin++;
+  return true;
+}
+
+bool WorkStealingPool::Steal_(int worker) {
+  int workers_count = GetWorkersCount();
+  for (int i = 1; i < workers_count; ++i) {
+    Queue& victim = queues_[(worker + i) % workers_count];
+    size_t begin;
+    size_t end;
+    {
+      std::lock_guard lock(victim.mutex);
+      size_t left = victim.end - victim.begin;
+      if (left == 0) {
+        continue;
+      }
+      end = victim.end;
+      begin = end - (left + 1) / 2;
+      victim.end = begin;
+    }
+    Queue& queue = queues_[worker];
+    std::lock_guard lock(queue.mutex);
+    queue.begin = begin;
+    queue.end = end;
+    return true;
+  }
+  return false;
+}
@@ -1,6 +1,23 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <sstream>
+#include <thread>
+
+#include "BigramFilter.h"
 #include "Grammar.h"
 #include "gtest/gtest.h"
 #include "LR1Parser.h"
+#include "LockstepParser.h"
+#include "MathDirectPredict.h"
+#include "MathTables.h"
+#include "PersistentStack.h"
+#include "StateProfile.h"
+#include "StaticGrammar.h"
+#include "TableCache.h"
 
 class TestEnvironment: public ::testing::Environment {
  public:
@@ -111,4 +128,697 @@ TEST_F(ParseTest, ParseRecursive) {
   EXPECT_TRUE(parser.Predict("ba"));
   EXPECT_TRUE(parser.Predict("baba"));
   EXPECT_TRUE(parser.Predict("bababa"));
-}
\ No newline at end of file
+}
+
+TEST_F(ParseTest, ParseWithDefaultReductions) {
+  parser.Fit(math_grammar);
+  EXPECT_FALSE(parser.Predict("x)"));
+  EXPECT_FALSE(parser.Predict("x+*y"));
+  EXPECT_FALSE(parser.Predict("x-y"));
+  EXPECT_FALSE(parser.Predict(")x"));
+  parser.Fit(strange_grammar);
+  EXPECT_TRUE(parser.Predict("dcd"));
+  EXPECT_FALSE(parser.Predict("ddd"));
+  EXPECT_FALSE(parser.Predict("dc"));
+  parser.Fit(brace_grammar);
+  EXPECT_FALSE(parser.Predict("abb"));
+  EXPECT_FALSE(parser.Predict("a#b"));
+}
+
+TEST_F(ParseTest, EliminateUnitRules) {
+  ParseTrace full_trace;
+  parser.Fit(math_grammar);
+  EXPECT_TRUE(parser.Predict("x+z", full_trace));
+  EXPECT_EQ(full_trace.reductions, full_trace.derivation.size());
+
+  ParseTrace short_trace;
+  parser.Fit(math_grammar, {.eliminate_unit_rules = true});
+  EXPECT_TRUE(parser.Predict("x+z", short_trace));
+  EXPECT_LT(short_trace.reductions, full_trace.reductions);
+  EXPECT_EQ(short_trace.derivation, full_trace.derivation);
+
+  EXPECT_TRUE(parser.Predict("x*((y+z)*z+(x*y+(x+y*z)*(x+y)))"));
+  EXPECT_FALSE(parser.Predict("x+y*)z("));
+  EXPECT_FALSE(parser.Predict("(((((((((x((((((((("));
+}
+
+TEST_F(ParseTest, TerminalClasses) {
+  parser.Fit(math_grammar);
+  const ParseTable& table = parser.GetTable();
+  EXPECT_EQ(table.symbol_classes['x'], table.symbol_classes['y']);
+  EXPECT_EQ(table.symbol_classes['x'], table.symbol_classes['z']);
+  EXPECT_NE(table.symbol_classes['x'], table.symbol_classes['+']);
+  EXPECT_NE(table.symbol_classes['x'], table.symbol_classes['#']);
+  EXPECT_EQ(table.classes_count, 7);
+  EXPECT_EQ(table.actions.size(), table.states_count * table.classes_count);
+  EXPECT_TRUE(parser.Predict("x+(y*z)"));
+  EXPECT_FALSE(parser.Predict("x+(y#z)"));
+}
+
+TEST_F(ParseTest, NarrowTableWidths) {
+  parser.Fit(math_grammar);
+  EXPECT_EQ(parser.GetCompiledParser()->GetStateBytes(), 1);
+  EXPECT_EQ(parser.GetCompiledParser()->GetCellBytes(), 1);
+
+  Grammar long_grammar({'a'}, {'S'}, {{'S', std::string(300, 'a')}}, 'S');
+  parser.Fit(long_grammar);
+  EXPECT_EQ(parser.GetCompiledParser()->GetStateBytes(), 2);
+  EXPECT_EQ(parser.GetCompiledParser()->GetCellBytes(), 2);
+  EXPECT_TRUE(parser.Predict(std::string(300, 'a')));
+  EXPECT_FALSE(parser.Predict(std::string(299, 'a')));
+  EXPECT_FALSE(parser.Predict(std::string(301, 'a')));
+
+  // 256 states no longer fit in a byte.
+  Grammar edge_grammar({'a'}, {'S'}, {{'S', std::string(254, 'a')}}, 'S');
+  parser.Fit(edge_grammar);
+  ASSERT_EQ(parser.GetTable().states_count, 256);
+  EXPECT_EQ(parser.GetCompiledParser()->GetStateBytes(), 2);
+  EXPECT_EQ(NativeParser(parser.GetTable()).GetStateBytes(), 2);
+}
+
+TEST_F(ParseTest, PerfectHashBackend) {
+  parser.Fit(math_grammar, {.backend = TableBackend::PERFECT_HASH});
+  EXPECT_TRUE(parser.Predict("x+x*y+x*y*z+(x*(x*(x*(y+z))))"));
+  EXPECT_TRUE(parser.Predict("((((((((((x))))))))))"));
+  EXPECT_FALSE(parser.Predict("x+(y+z"));
+  EXPECT_FALSE(parser.Predict("x+y*)z("));
+  EXPECT_FALSE(parser.Predict("x#y"));
+  parser.Fit(brace_grammar, {.backend = TableBackend::PERFECT_HASH});
+  EXPECT_TRUE(parser.Predict("aaabbabb"));
+  EXPECT_TRUE(parser.Predict(""));
+  EXPECT_FALSE(parser.Predict("abba"));
+}
+
+TEST_F(ParseTest, SaveAndLoad) {
+  std::stringstream file;
+  parser.Fit(math_grammar, {.backend = TableBackend::PERFECT_HASH});
+  parser.Save(file);
+
+  LR1Parser loaded;
+  loaded.Load(file);
+  EXPECT_EQ(loaded.GetTable().actions, parser.GetTable().actions);
+  EXPECT_EQ(loaded.GetTable().gotos, parser.GetTable().gotos);
+  EXPECT_EQ(loaded.GetTable().rules, parser.GetTable().rules);
+  EXPECT_NE(std::dynamic_pointer_cast<const PerfectHashParser>(
+                loaded.GetCompiledParser()), nullptr);
+  EXPECT_TRUE(loaded.Predict("x*((y+z)*z+(x*y+(x+y*z)*(x+y)))"));
+  EXPECT_FALSE(loaded.Predict("x+(y+z"));
+
+  std::string truncated = file.str();
+  truncated.resize(truncated.size() / 2);
+  std::stringstream truncated_file(truncated);
+  EXPECT_THROW(loaded.Load(truncated_file), std::runtime_error);
+  std::stringstream garbage_file("garbage");
+  EXPECT_THROW(loaded.Load(garbage_file), std::runtime_error);
+  // The last rule's length is the final field of the file. As long as the
+  // table, it pops past the bottom of any stack that reduces it.
+  std::string long_rule = file.str();
+  for (int i = 0; i < 4; ++i) {
+    long_rule[long_rule.size() - 4 + i] =
+        static_cast<char>(parser.GetTable().states_count >> (8 * i));
+  }
+  std::stringstream long_rule_file(long_rule);
+  EXPECT_THROW(loaded.Load(long_rule_file), std::runtime_error);
+}
+
+TEST_F(ParseTest, MapImage) {
+  std::string path = ::testing::TempDir() + "math_grammar.lr1i";
+  parser.Fit(math_grammar);
+  parser.SaveImage(path);
+
+  LR1Parser mapped;
+  mapped.MapImage(path);
+  EXPECT_EQ(mapped.GetCompiledParser()->GetCellBytes(), 1);
+  EXPECT_TRUE(mapped.Predict("x*((y+z)*z+(x*y+(x+y*z)*(x+y)))"));
+  EXPECT_TRUE(mapped.Predict("((((((((((x))))))))))"));
+  EXPECT_FALSE(mapped.Predict("x+(y+z"));
+
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(-1, std::ios::end);
+    file.put('\x7f');
+  }
+  EXPECT_THROW(mapped.MapImage(path), std::runtime_error);
+  EXPECT_NO_THROW(mapped.MapImage(path, false));
+
+  // Verification doesn't stop at the checksum: this image's matches, but a
+  // reduction pops past the bottom of the stack.
+  ParseTable table = parser.GetTable();
+  table.rules.back().length = table.states_count;
+  {
+    std::ofstream file(path, std::ios::binary);
+    TableImage::Build(table)->Write(file);
+  }
+  EXPECT_THROW(mapped.MapImage(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST_F(ParseTest, TableCache) {
+  Grammar shuffled_grammar(
+      {'*', '+', ')', '(', 'z', 'y', 'x'}, {'T', 'P', 'S'},
+      math_grammar.GetProductionRules(), 'S');
+  EXPECT_EQ(GetFingerprint(math_grammar, {}),
+            GetFingerprint(shuffled_grammar, {}));
+  EXPECT_NE(GetFingerprint(math_grammar, {}),
+            GetFingerprint(brace_grammar, {}));
+  EXPECT_NE(GetFingerprint(math_grammar, {}),
+            GetFingerprint(math_grammar, {.eliminate_unit_rules = true}));
+
+  std::string directory = ::testing::TempDir() + "lr1_table_cache";
+  std::filesystem::remove_all(directory);
+  {
+    TableCache cache(directory);
+    parser.Fit(math_grammar, {.cache = &cache});
+    parser.Fit(shuffled_grammar, {.cache = &cache});
+    EXPECT_EQ(cache.GetMissesCount(), 1);
+    EXPECT_EQ(cache.GetHitsCount(), 1);
+  }
+  TableCache cache(directory);
+  LR1Parser cached_parser;
+  cached_parser.Fit(math_grammar, {.cache = &cache});
+  EXPECT_EQ(cache.GetHitsCount(), 1);
+  EXPECT_EQ(cached_parser.GetTable().actions, parser.GetTable().actions);
+  EXPECT_TRUE(cached_parser.Predict("x+x*y+x*y*z+(x*(x*(x*(y+z))))"));
+  EXPECT_FALSE(cached_parser.Predict("x+y*)z("));
+  std::filesystem::remove_all(directory);
+
+  // Without a directory to write to, only the memory tier is left.
+  TableCache unwritable(directory);
+  std::filesystem::remove_all(directory);
+  EXPECT_NO_THROW(cached_parser.Fit(brace_grammar, {.cache = &unwritable}));
+  cached_parser.Fit(brace_grammar, {.cache = &unwritable});
+  EXPECT_EQ(unwritable.GetHitsCount(), 1);
+  EXPECT_TRUE(cached_parser.Predict("aaabbabb"));
+  EXPECT_FALSE(std::filesystem::exists(directory));
+}
+
+TEST_F(ParseTest, GeneratedTables) {
+  static_assert(StaticPredict<MathTables>("x+(y*z)"));
+  static_assert(!StaticPredict<MathTables>("x+(y*z"));
+  parser.Fit(math_grammar);
+  for (const char* word : {"x", "x+z", "((((((((((x))))))))))",
+                           "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "", "x+",
+                           "x+y*)z(", "(((((((((x(((((((((", "x#y"}) {
+    EXPECT_EQ(StaticPredict<MathTables>(word), parser.Predict(word)) << word;
+  }
+
+  std::stringstream grammar_file("S -> aSbS |\n");
+  parser.Fit(ReadGrammar(grammar_file));
+  EXPECT_TRUE(parser.Predict("aabbab"));
+  EXPECT_FALSE(parser.Predict("abba"));
+  std::stringstream bad_grammar_file("S = a\n");
+  EXPECT_THROW(ReadGrammar(bad_grammar_file), std::invalid_argument);
+}
+
+TEST_F(ParseTest, StaticGrammar) {
+  using StaticMath = StaticGrammar<"S -> S+P | P\n"
+                                   "P -> P*T | T\n"
+                                   "T -> (S) | x | y | z\n">;
+  using StaticBraces = StaticGrammar<"S -> aSbS |">;
+  static_assert(StaticPredict<StaticMath>("x*((y+z)*z+(x*y+(x+y*z)*(x+y)))"));
+  static_assert(!StaticPredict<StaticMath>("x+y*)z("));
+  static_assert(StaticPredict<StaticBraces>("aaabbabb"));
+  static_assert(!StaticPredict<StaticBraces>("abba"));
+
+  parser.Fit(math_grammar);
+  for (const char* word : {"x", "x+z", "((((((((((x))))))))))", "", "x+",
+                           "x+(y+z", "(((((((((x(((((((((", "x#y"}) {
+    EXPECT_EQ(StaticPredict<StaticMath>(word), parser.Predict(word)) << word;
+  }
+  parser.Fit(brace_grammar);
+  for (const char* word : {"aabb", "", "ababab", "aaabbbabab", "abba", "a",
+                           "bb", "bbbaaa"}) {
+    EXPECT_EQ(StaticPredict<StaticBraces>(word), parser.Predict(word)) << word;
+  }
+}
+
+TEST_F(ParseTest, DirectCodedParser) {
+  parser.Fit(math_grammar);
+  for (const char* word : {"x", "x+z", "((((((((((x))))))))))",
+                           "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "", "x+",
+                           "x+y*)z(", "(((((((((x(((((((((", "x#y"}) {
+    EXPECT_EQ(MathDirectPredict(word), parser.Predict(word)) << word;
+  }
+}
+
+TEST_F(ParseTest, ThreadedBackend) {
+  LR1Parser threaded;
+  for (const Grammar* grammar : {&math_grammar, &brace_grammar}) {
+    parser.Fit(*grammar);
+    threaded.Fit(*grammar, {.backend = TableBackend::THREADED});
+    for (const char* word : {"x", "x+z", "((((((((((x))))))))))",
+                             "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "", "x+",
+                             "x+y*)z(", "aaabbabb", "abba", "x#y"}) {
+      EXPECT_EQ(threaded.Predict(word), parser.Predict(word)) << word;
+    }
+  }
+  EXPECT_TRUE(threaded.Predict("aababb"));
+  EXPECT_FALSE(threaded.Predict("aab"));
+}
+
+TEST_F(ParseTest, NativeParser) {
+  parser.Fit(math_grammar);
+  std::shared_future<void> compilation = parser.CompileNative();
+  EXPECT_TRUE(parser.Predict("x+y*z"));
+  compilation.get();
+  EXPECT_EQ(parser.GetCompiledParser()->GetCellBytes(), 0);
+  for (const char* word : {"x", "x+z", "((((((((((x))))))))))",
+                           "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "", "x+",
+                           "x+y*)z(", "(((((((((x(((((((((", "x#y"}) {
+    EXPECT_EQ(parser.Predict(word), MathDirectPredict(word)) << word;
+  }
+
+  parser.Fit(brace_grammar);
+  EXPECT_THROW(parser.CompileNative({.compiler = "false"}).get(),
+               std::runtime_error);
+  EXPECT_TRUE(parser.Predict("aaabbabb"));
+  EXPECT_FALSE(parser.Predict("abba"));
+}
+
+TEST_F(ParseTest, NativeRecompileWhilePredicting) {
+  parser.Fit(math_grammar);
+  std::atomic<bool> done = false;
+  std::atomic<int> mismatches = 0;
+  std::thread reader([&] {
+    while (!done.load()) {
+      if (!parser.Predict("x*(y+z)") || parser.Predict("x+y*)z(")) {
+        ++mismatches;
+      }
+    }
+  });
+  parser.CompileNative().get();
+  parser.CompileNative().get();
+  done = true;
+  reader.join();
+  EXPECT_EQ(mismatches, 0);
+  EXPECT_EQ(parser.GetCompiledParser()->GetCellBytes(), 0);
+}
+
+TEST_F(ParseTest, JitBackend) {
+  LR1Parser jit;
+  for (const Grammar* grammar : {&math_grammar, &brace_grammar}) {
+    parser.Fit(*grammar);
+    jit.Fit(*grammar, {.backend = TableBackend::JIT});
+    for (const char* word : {"x", "x+z", "((((((((((x))))))))))",
+                             "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "", "x+",
+                             "x+y*)z(", "aaabbabb", "abba", "x#y"}) {
+      EXPECT_EQ(jit.Predict(word), parser.Predict(word)) << word;
+    }
+  }
+  if (JitParser::IsSupported()) {
+    EXPECT_EQ(jit.GetCompiledParser()->GetCellBytes(), 0);
+  }
+  // Deeper than the initial stack.
+  std::string nested = std::string(1000, 'a') + std::string(1000, 'b');
+  EXPECT_TRUE(jit.Predict(nested));
+  EXPECT_FALSE(jit.Predict(nested + "b"));
+}
+
+TEST_F(ParseTest, HotStates) {
+  parser.Fit(math_grammar);
+  const ParseTable& table = parser.GetTable();
+  std::vector<std::string> samples = {"x+y*z", "((x))", "x*(y+z)", "x+"};
+  std::vector<uint64_t> profile = ProfileStates(table, samples);
+  EXPECT_EQ(profile[0], samples.size());
+  std::vector<int> hot_states = GetHotStates(profile, 3);
+  ASSERT_EQ(hot_states.size(), 3);
+  EXPECT_GE(profile[hot_states[0]], profile[hot_states[1]]);
+  EXPECT_GE(profile[hot_states[1]], profile[hot_states[2]]);
+  EXPECT_EQ(GetHotStates(profile, 1000).size(),
+            std::count_if(profile.begin(), profile.end(),
+                          [](uint64_t count) { return count > 0; }));
+
+  NativeParser hybrid(table, {.hot_states = hot_states});
+  for (const char* word : {"x", "x+z", "((((((((((x))))))))))",
+                           "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "", "x+",
+                           "x+y*)z(", "(((((((((x(((((((((", "x#y"}) {
+    EXPECT_EQ(hybrid.Predict(word), parser.Predict(word)) << word;
+  }
+}
+
+TEST_F(ParseTest, InputRanges) {
+  parser.Fit(math_grammar);
+  std::string buffer = "x+(y*z)x+y)";
+  std::string_view word(buffer.data(), 7);
+  EXPECT_TRUE(parser.Predict(word));
+  EXPECT_FALSE(parser.Predict(std::string_view(buffer.data(), 6)));
+  EXPECT_TRUE(parser.Predict(std::span<const char>(buffer.data() + 7, 3)));
+  EXPECT_TRUE(parser.Predict(std::vector<char>{'x', '*', 'y'}));
+  EXPECT_TRUE(parser.Predict(std::list<char>{'(', 'x', ')'}));
+  EXPECT_FALSE(parser.Predict(std::list<char>{'(', 'x'}));
+  std::vector<uint16_t> tokens = {'x', '+', 'y'};
+  EXPECT_TRUE(parser.Predict(tokens));
+  tokens[1] = '+' + 256;
+  EXPECT_FALSE(parser.Predict(tokens));
+
+  // The end of input is explicit, NUL is an ordinary foreign byte.
+  std::string with_nul("x\0+y", 4);
+  for (auto backend : {TableBackend::DENSE, TableBackend::PERFECT_HASH,
+                       TableBackend::THREADED, TableBackend::JIT}) {
+    parser.Fit(math_grammar, {.backend = backend});
+    EXPECT_FALSE(parser.Predict(with_nul));
+    EXPECT_FALSE(parser.Predict(std::string_view(with_nul.data(), 2)));
+    EXPECT_TRUE(parser.Predict(std::string_view(with_nul.data(), 1)));
+    EXPECT_TRUE(parser.Predict(word));
+    EXPECT_FALSE(parser.Predict(std::vector<uint16_t>{'x', 0}));
+    EXPECT_TRUE(parser.Predict(std::vector<uint16_t>{'(', 'x', ')'}));
+  }
+  ParseTrace trace;
+  EXPECT_FALSE(parser.Predict(with_nul, trace));
+  EXPECT_FALSE(MathDirectPredict(with_nul));
+  EXPECT_TRUE(MathDirectPredict(std::string_view(with_nul.data(), 1)));
+  static_assert(!StaticPredict<MathTables>(std::string_view("x\0", 2)));
+}
+
+TEST_F(ParseTest, PushParser) {
+  parser.Fit(math_grammar);
+  std::unique_ptr<PushParser> push = parser.MakePushParser();
+  for (std::string word : {"x", "x+z", "((((((((((x))))))))))",
+                           "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "", "x+",
+                           "x+y*)z(", "(((((((((x(((((((((", "x#y"}) {
+    for (size_t split = 0; split <= word.size(); ++split) {
+      push->Begin();
+      push->Feed(std::string_view(word).substr(0, split));
+      push->Feed(std::string_view(word).substr(split));
+      EXPECT_EQ(push->Finish(), parser.Predict(word)) << word << " " << split;
+    }
+  }
+
+  push->Begin();
+  EXPECT_TRUE(push->Feed("x+("));
+  EXPECT_FALSE(push->Feed(")y"));
+  EXPECT_FALSE(push->Feed("x)"));
+  EXPECT_FALSE(push->Finish());
+
+  push->Begin();
+  for (char symbol : std::string("(x*(y+z))")) {
+    EXPECT_TRUE(push->Feed(std::string_view(&symbol, 1)));
+  }
+  EXPECT_TRUE(push->Finish());
+  EXPECT_TRUE(push->Finish());
+}
+
+TEST_F(ParseTest, PredictBatch) {
+  std::vector<std::string> words = {"x", "x+z", "((((((((((x))))))))))",
+                                    "x*((y+z)*z+(x*y+(x+y*z)*(x+y)))", "",
+                                    "x+", "x+y*)z(", "(((((((((x(((((((((",
+                                    "x#y"};
+  std::string buffer;
+  std::vector<size_t> offsets = {0};
+  for (int i = 0; i < 500; ++i) {
+    buffer += words[i * 7 % words.size()];
+    offsets.push_back(buffer.size());
+  }
+  WorkStealingPool pool(3);
+  EXPECT_EQ(pool.GetWorkersCount(), 4);
+  for (auto backend : {TableBackend::DENSE, TableBackend::JIT}) {
+    parser.Fit(math_grammar, {.backend = backend});
+    std::vector<uint64_t> accepted = parser.PredictBatch(buffer, offsets,
+                                                         &pool);
+    ASSERT_EQ(accepted.size(), 8);
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+      bool expected = parser.Predict(std::string_view(buffer).substr(
+          offsets[i], offsets[i + 1] - offsets[i]));
+      EXPECT_EQ((accepted[i / 64] >> (i % 64)) & 1, expected) << i;
+    }
+    EXPECT_EQ(accepted, parser.PredictBatch(buffer, offsets));
+  }
+  EXPECT_TRUE(parser.PredictBatch(buffer, std::vector<size_t>{}).empty());
+  EXPECT_THROW(parser.PredictBatch("x", std::vector<size_t>{0, 2}),
+               std::invalid_argument);
+
+  // Whichever worker throws, Run waits for the others before rethrowing.
+  for (size_t thrower : {0, 5, 9}) {
+    std::atomic<int> blocks_run = 0;
+    EXPECT_THROW(pool.Run(10, 1, [&](size_t begin, size_t, int) {
+      ++blocks_run;
+      if (begin == thrower) {
+        throw std::runtime_error("Block failed.");
+      }
+    }), std::runtime_error);
+    EXPECT_GE(blocks_run, 1);
+  }
+  std::atomic<int> blocks_run = 0;
+  pool.Run(10, 1, [&](size_t, size_t, int) {
+    ++blocks_run;
+  });
+  EXPECT_EQ(blocks_run, 10);
+}
+
+TEST_F(ParseTest, LockstepParser) {
+  parser.Fit(math_grammar);
+  LockstepParser lockstep(parser.GetTable());
+  std::vector<std::string> words = {"x", "", "x+y*z", "(x)", "x+", ")",
+                                    "(((((((((((((((((((x)))))))))))))))))))",
+                                    "((((((((((((((((((((((((((((((((x",
+                                    "x*(y+z)+x*(y+z)+x*(y+z)+x*(y+z)+x",
+                                    std::string("x\0y", 3), "x#"};
+  std::string buffer;
+  std::vector<size_t> offsets = {0};
+  for (int i = 0; i < 300; ++i) {
+    buffer += words[i * 5 % words.size()];
+    offsets.push_back(buffer.size());
+  }
+  std::vector<uint64_t> accepted(5, ~uint64_t{0});
+  lockstep.Predict(buffer, offsets, accepted.data());
+  for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+    bool expected = parser.Predict(std::string_view(buffer).substr(
+        offsets[i], offsets[i + 1] - offsets[i]));
+    EXPECT_EQ((accepted[i / 64] >> (i % 64)) & 1, expected) << i;
+  }
+  EXPECT_EQ(accepted[4] >> (300 % 64), 0);
+}
+
+TEST_F(ParseTest, PersistentStack) {
+  StackArena arena;
+  PersistentStack empty;
+  EXPECT_TRUE(empty.IsEmpty());
+  EXPECT_THROW(static_cast<void>(empty.Top()), std::out_of_range);
+  EXPECT_THROW(static_cast<void>(empty.Pop()), std::out_of_range);
+  PersistentStack stack = empty;
+  for (int i = 0; i < 40; ++i) {
+    stack = stack.Push(arena, i);
+  }
+  EXPECT_EQ(stack.GetSize(), 40);
+  EXPECT_EQ(stack.Top(), 39);
+  size_t segments_count = arena.GetSegmentsCount();
+  EXPECT_EQ(segments_count,
+            (40 + StackArena::kSegmentSize - 1) / StackArena::kSegmentSize);
+
+  // Forks share everything below the point where they part.
+  PersistentStack snapshot = stack.Pop(25);
+  PersistentStack left = snapshot.Push(arena, 100).Push(arena, 101);
+  PersistentStack right = snapshot.Push(arena, 200);
+  // Pushing the state the slot already holds shares it.
+  PersistentStack same = snapshot.Push(arena, 15);
+  EXPECT_EQ(snapshot.Top(), 14);
+  EXPECT_EQ(left.Top(), 101);
+  EXPECT_EQ(left.Pop().Top(), 100);
+  EXPECT_EQ(right.Top(), 200);
+  EXPECT_EQ(right.Pop().Top(), 14);
+  EXPECT_EQ(same.Top(), 15);
+  EXPECT_EQ(same.Push(arena, 16).Push(arena, 17).Top(), 17);
+  EXPECT_EQ(stack.Top(), 39);
+  EXPECT_EQ(stack.Pop(24).Top(), 15);
+  EXPECT_EQ(arena.GetSegmentsCount(), segments_count + 2);
+  EXPECT_TRUE(stack.Pop(40).IsEmpty());
+
+  arena.Reset();
+  EXPECT_EQ(arena.GetSegmentsCount(), 0);
+  PersistentStack reused = PersistentStack().Push(arena, 7);
+  EXPECT_EQ(reused.Top(), 7);
+}
+
+TEST_F(ParseTest, PrefixSharingBatch) {
+  std::vector<std::string> stems = {"", "x", "(x+y", "((x*", "x)", "(((("};
+  std::vector<std::string> endings = {"", ")", "z)", "y", "+z", "(", "))"};
+  std::string buffer;
+  std::vector<size_t> offsets = {0};
+  for (int repeat = 0; repeat < 2; ++repeat) {
+    for (const auto& stem : stems) {
+      for (const auto& ending : endings) {
+        buffer += stem + ending;
+        offsets.push_back(buffer.size());
+      }
+    }
+  }
+  buffer += std::string("(x\0", 3);
+  offsets.push_back(buffer.size());
+  for (bool unit_rules : {false, true}) {
+    parser.Fit(math_grammar, {.eliminate_unit_rules = unit_rules});
+    std::vector<uint64_t> accepted =
+        parser.PredictBatchSharingPrefixes(buffer, offsets);
+    EXPECT_EQ(accepted, parser.PredictBatch(buffer, offsets));
+    EXPECT_NE(accepted, std::vector<uint64_t>(accepted.size(), 0));
+  }
+  EXPECT_THROW(parser.PredictBatchSharingPrefixes("x",
+                                                   std::vector<size_t>{1, 0}),
+               std::invalid_argument);
+}
+
+TEST_F(ParseTest, BigramFilter) {
+  BigramFilter filter(math_grammar);
+  EXPECT_TRUE(filter.Admits("x+y*(z)"));
+  EXPECT_FALSE(filter.Admits(""));
+  EXPECT_FALSE(filter.Admits("xy"));
+  EXPECT_FALSE(filter.Admits("+x"));
+  EXPECT_FALSE(filter.Admits("x*"));
+  EXPECT_FALSE(filter.Admits("x#"));
+  EXPECT_FALSE(filter.Admits(std::string("x\0", 2)));
+  // The conditions are only necessary, "(x" passes them.
+  EXPECT_TRUE(filter.Admits("(x"));
+  std::string long_word;
+  for (int i = 0; i < 40; ++i) {
+    long_word += "(x+y)*";
+  }
+  long_word += "z";
+  EXPECT_TRUE(filter.Admits(long_word));
+  EXPECT_FALSE(filter.Admits(long_word + "\xFF"));
+  std::string misplaced = long_word;
+  misplaced[100] = '#';
+  EXPECT_FALSE(filter.Admits(misplaced));
+  EXPECT_TRUE(filter.Admits(std::vector<uint16_t>{'x', '+', 'y'}));
+  EXPECT_FALSE(filter.Admits(std::vector<uint16_t>{'x', '+' + 256, 'y'}));
+
+  BigramFilter brace_filter(brace_grammar);
+  EXPECT_TRUE(brace_filter.Admits(""));
+  parser.Fit(math_grammar);
+  EXPECT_TRUE(parser.Predict(long_word));
+  EXPECT_FALSE(parser.Predict(misplaced));
+  EXPECT_FALSE(parser.Predict(std::vector<uint16_t>{'x', '+' + 256, 'y'}));
+  parser.Fit(math_grammar, {.filter_input = false});
+  EXPECT_TRUE(parser.Predict(long_word));
+  EXPECT_FALSE(parser.Predict(misplaced));
+}
+
+TEST_F(ParseTest, RegularFilter) {
+  parser.Fit(math_grammar);
+  RegularFilter shallow(parser.GetTable(), 1);
+  RegularFilter deep(parser.GetTable(), 8);
+  EXPECT_EQ(deep.GetDepth(), 8);
+  EXPECT_LT(shallow.GetStatesCount(), deep.GetStatesCount());
+  std::vector<std::string> words = {"", "x", "x+y*z", "(x", "x)", "(x)*(y",
+                                    "((x+y)*z)", "xy", "x+#", "(((((x))))",
+                                    "((((((((((x))))))))))"};
+  for (const auto& word : words) {
+    bool accepted = parser.Predict(word);
+    if (accepted) {
+      EXPECT_TRUE(shallow.Admits(word)) << word;
+    }
+    // Stacks of shallow words aren't cut, so these are exact.
+    if (word.size() < 8) {
+      EXPECT_EQ(deep.Admits(word), accepted) << word;
+    }
+  }
+  EXPECT_TRUE(shallow.Admits("(x"));
+  EXPECT_FALSE(deep.Admits("(x"));
+  // Nesting deeper than the cut can't be counted.
+  EXPECT_TRUE(deep.Admits("((((((((((x)))))))))"));
+  EXPECT_FALSE(deep.Admits(std::vector<uint16_t>{'(', 'x', ')' + 256}));
+  EXPECT_THROW(RegularFilter(parser.GetTable(), 0), std::invalid_argument);
+
+  parser.Fit(math_grammar, {.filter_input = false, .prefilter_depth = 4});
+  EXPECT_TRUE(parser.Predict("(x+y)*z"));
+  EXPECT_FALSE(parser.Predict("(x+y*z"));
+}
+
+TEST_F(ParseTest, ResultCache) {
+  ResultCache cache(4, 2);
+  EXPECT_FALSE(cache.Find("x").has_value());
+  cache.Insert("x", true);
+  cache.Insert("y", false);
+  EXPECT_EQ(cache.Find("x"), true);
+  EXPECT_EQ(cache.Find("y"), false);
+  EXPECT_EQ(cache.GetHitsCount(), 2);
+  EXPECT_EQ(cache.GetMissesCount(), 1);
+  for (char symbol = 'a'; symbol <= 'p'; ++symbol) {
+    cache.Insert(std::string(1, symbol), true);
+  }
+  EXPECT_LE(cache.GetSize(), 4);
+  cache.Insert(std::string(ResultCache::kMaxWordSize + 1, 'x'), true);
+  EXPECT_FALSE(cache.Find(std::string(ResultCache::kMaxWordSize + 1, 'x'))
+                   .has_value());
+  EXPECT_THROW(ResultCache(0), std::invalid_argument);
+
+  // A hit spares an entry from the next sweep of the hand.
+  ResultCache clock(2, 1);
+  clock.Insert("a", true);
+  clock.Insert("b", true);
+  EXPECT_EQ(clock.Find("a"), true);
+  clock.Insert("c", true);
+  EXPECT_EQ(clock.Find("a"), true);
+  EXPECT_FALSE(clock.Find("b").has_value());
+
+  parser.Fit(math_grammar, {.result_cache_capacity = 64});
+  ASSERT_NE(parser.GetResultCache(), nullptr);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(parser.Predict("x+y"));
+    EXPECT_FALSE(parser.Predict("x+"));
+  }
+  EXPECT_EQ(parser.GetResultCache()->GetHitsCount(), 4);
+  EXPECT_EQ(parser.GetResultCache()->GetMissesCount(), 2);
+  // Words too long to be kept bypass the cache.
+  std::string long_word = "x";
+  while (long_word.size() <= ResultCache::kMaxWordSize) {
+    long_word += "+x";
+  }
+  EXPECT_TRUE(parser.Predict(long_word));
+  EXPECT_EQ(parser.GetResultCache()->GetMissesCount(), 2);
+  parser.Fit(math_grammar);
+  EXPECT_EQ(parser.GetResultCache(), nullptr);
+}
+
+TEST_F(ParseTest, NextTerminals) {
+  auto expected_set = [](std::string symbols, bool end) {
+    std::bitset<256> expected;
+    for (char symbol : symbols) {
+      expected.set(static_cast<uint8_t>(symbol));
+    }
+    expected[0] = end;
+    return expected;
+  };
+  for (bool unit_rules : {false, true}) {
+    parser.Fit(math_grammar, {.eliminate_unit_rules = unit_rules});
+    EXPECT_EQ(parser.GetNextTerminals("").expected,
+              expected_set("xyz(", false));
+    EXPECT_EQ(parser.GetNextTerminals("x").expected,
+              expected_set("+*", true));
+    // Merged in the dense tables, apart here.
+    EXPECT_EQ(parser.GetNextTerminals("(x").expected,
+              expected_set("+*)", false));
+    EXPECT_EQ(parser.GetNextTerminals("(x)*y").expected,
+              expected_set("+*", true));
+    NextTerminals next = parser.GetNextTerminals("(x+y)z*");
+    EXPECT_EQ(next.error_position, 5);
+    EXPECT_EQ(next.expected, expected_set("+*", true));
+    EXPECT_EQ(parser.GetNextTerminals("xS").error_position, 1);
+    EXPECT_EQ(parser.GetNextTerminals(std::string("(\0", 2)).error_position,
+              1);
+
+    // Bit 0 agrees with Predict, the others with extending the prefix.
+    std::vector<std::string> prefixes = {""};
+    for (size_t i = 0; i < prefixes.size() && prefixes[i].size() < 4; ++i) {
+      for (char symbol : std::string("xy+*()")) {
+        prefixes.push_back(prefixes[i] + symbol);
+      }
+    }
+    for (const auto& prefix : prefixes) {
+      NextTerminals next = parser.GetNextTerminals(prefix);
+      if (next.error_position != std::string_view::npos) {
+        EXPECT_FALSE(parser.Predict(prefix)) << prefix;
+        continue;
+      }
+      EXPECT_EQ(next.expected[0], parser.Predict(prefix)) << prefix;
+      for (char symbol : std::string("xy+*()#")) {
+        EXPECT_EQ(next.expected[static_cast<uint8_t>(symbol)],
+                  parser.GetNextTerminals(prefix + symbol).error_position ==
+                      std::string_view::npos) << prefix << symbol;
+      }
+    }
+  }
+  TableCache cache;
+  parser.Fit(math_grammar, {.cache = &cache});
+  parser.Fit(math_grammar, {.cache = &cache});
+  EXPECT_THROW(static_cast<void>(parser.GetNextTerminals("x")),
+               std::logic_error);
+}
@@ -0,0 +1,74 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "CodeGenerator.h"
+#include "Grammar.h"
+#include "LR1Parser.h"
+#include "StateProfile.h"
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " <grammar> <output header> <name>"
+                 " [--direct] [--hot <count> <samples>]"
+                 " [--eliminate-unit-rules]\n"
+              << "Writes constexpr tables as struct <name>, or with --direct"
+                 " a direct-coded parser function <name>.\n"
+              << "With --hot only the <count> states entered most often"
+                 " while parsing the lines of <samples> are direct-coded.\n";
+    return 2;
+  }
+  FitOptions options;
+  bool direct = false;
+  int hot_count = 0;
+  const char* samples_path = nullptr;
+  for (int i = 4; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--direct") == 0) {
+      direct = true;
+    } else if (std::strcmp(argv[i], "--hot") == 0 && i + 2 < argc) {
+      hot_count = std::atoi(argv[i + 1]);
+      samples_path = argv[i + 2];
+      i += 2;
+    } else if (std::strcmp(argv[i], "--eliminate-unit-rules") == 0) {
+      options.eliminate_unit_rules = true;
+    } else {
+      std::cerr << "Unknown option " << argv[i] << "\n";
+      return 2;
+    }
+  }
+  try {
+    std::ifstream in(argv[1]);
+    if (!in) {
+      std::cerr << "Can't open " << argv[1] << "\n";
+      return 1;
+    }
+    LR1Parser parser;
+    parser.Fit(ReadGrammar(in), options);
+    std::ofstream out(argv[2]);
+    if (samples_path != nullptr) {
+      std::ifstream samples_in(samples_path);
+      if (!samples_in) {
+        std::cerr << "Can't open " << samples_path << "\n";
+        return 1;
+      }
+      std::vector<std::string> samples;
+      for (std::string line; std::getline(samples_in, line);) {
+        samples.push_back(line);
+      }
+      WriteHybridParser(out, parser.GetTable(), argv[3],
+                        GetHotStates(ProfileStates(parser.GetTable(), samples),
+                                     hot_count));
+    } else if (direct) {
+      WriteDirectParser(out, parser.GetTable(), argv[3]);
+    } else {
+      WriteTablesHeader(out, parser.GetTable(), argv[3]);
+    }
+  } catch (const std::exception& error) {
+    std::cerr << argv[1] << ": " << error.what() << "\n";
+    return 1;
+  }
+  return 0;
+}